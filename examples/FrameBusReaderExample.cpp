@@ -0,0 +1,81 @@
+// Reads the frames DoomFire publishes with --frame-bus from another process, the way an LED wall driver would:
+// each frame is reduced in place in the shared memory, then checked for having been overwritten meanwhile.
+// It measures the latency from the publication to the reader holding the frame, wake-up included, and the time of
+// the reduction itself.
+//
+// Usage: DoomFireBusReader [NAME] [FRAMES]
+#include "FrameBus.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace {
+std::int64_t now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+double percentile(std::vector<std::int64_t> values, double p) {
+  if (values.empty())
+    return 0;
+  auto index = static_cast<std::size_t>(p * static_cast<double>(values.size() - 1));
+  std::nth_element(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(index), values.end());
+  return static_cast<double>(values[index]) / 1000.;
+}
+}// namespace
+
+int main(int argc, char **argv) {
+  const std::string name = argc > 1 ? argv[1] : FrameBus::DefaultName;
+  const auto count = argc > 2 ? std::atoi(argv[2]) : 600;
+
+  try {
+    FrameBusReader reader(name);
+    const auto &header = reader.getHeader();
+    std::cout << "Frame bus " << name << ": " << header.width << "x" << header.height << ", " << header.slotCount
+              << " slots, " << header.numColors << " colors\n";
+
+    std::vector<std::int64_t> latencies;
+    latencies.reserve(static_cast<std::size_t>(count));
+    std::int64_t readTime = 0;
+    std::uint64_t torn = 0;
+    std::uint64_t brightness = 0;
+    const auto numPixels = static_cast<std::size_t>(header.width) * header.height;
+    while (static_cast<int>(latencies.size()) < count && !reader.isClosed()) {
+      if (!reader.wait(1000))
+        continue;
+      FrameBusReader::Frame frame;
+      if (!reader.acquire(frame))
+        continue;
+      const auto acquired = now();
+
+      // the reduction reads the shared memory directly, nothing is copied
+      std::uint64_t sum = 0;
+      for (std::size_t i = 0; i < numPixels; ++i) {
+        sum += frame.indices[i];
+      }
+      if (!reader.validate(frame)) {
+        torn++;
+        continue;
+      }
+      brightness = sum / std::max<std::size_t>(numPixels, 1);
+      readTime += now() - acquired;
+      latencies.push_back(acquired - frame.timestamp);
+    }
+
+    std::cout << latencies.size() << " frames read, " << reader.getMissed() << " missed, " << torn
+              << " overwritten while read, last average intensity " << brightness << "\n"
+              << "latency from publication: min " << percentile(latencies, 0.) << " us, median "
+              << percentile(latencies, .5) << " us, 99th percentile " << percentile(latencies, .99) << " us, max "
+              << percentile(latencies, 1.) << " us\n"
+              << "reduction in place: "
+              << static_cast<double>(readTime) / 1000. / static_cast<double>(std::max<std::size_t>(latencies.size(), 1))
+              << " us/frame\n";
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -1,15 +1,23 @@
 #include "Application.h"
+#include "Debug.h"
+#include "FireSnapshot.h"
 #include "StopWatch.h"
 #include <imgui.h>
 #include <imgui/examples/imgui_impl_opengl3.h>
 #include <imgui/examples/imgui_impl_sdl.h>
+#include <GL/glew.h>
+#include <algorithm>
+#include <iostream>
 #include <utility>
 
 namespace {
-const TimeSpan TimePerFrame = TimeSpan::seconds(1.f / 60.f);
+constexpr int TicksPerSecond = 60;
+const TimeSpan TimePerFrame = TimeSpan::seconds(1.f / TicksPerSecond);
 }
 
-Application::Application() = default;
+Application::Application(ApplicationSettings settings) : m_settings(settings) {
+  std::copy(std::begin(FirePalette::Colors), std::end(FirePalette::Colors), m_palette.begin());
+}
 
 Application::~Application() = default;
 
@@ -18,17 +26,30 @@ void Application::run() {
   processEvents();
 
   int frames = 0;
+  StopWatch runStopWatch;
   StopWatch fpsStopWatch;
   StopWatch stopWatch;
   auto timeSinceLastUpdate = TimeSpan::Zero;
+  // a headless render to a stream advances one tick per frame, the video does not depend on how fast it is produced
+  const bool offline = m_window.isHeadless() && m_streamer;
   // Main loop
   while (!m_done) {
     auto elapsed = stopWatch.restart();
-    timeSinceLastUpdate += elapsed;
-    while (timeSinceLastUpdate > TimePerFrame) {
-      timeSinceLastUpdate -= TimePerFrame;
+    if (offline) {
+      // each frame shows its tick: --frames N renders N ticks
       processEvents();
       onUpdate(TimePerFrame);
+    } else {
+      timeSinceLastUpdate += elapsed;
+      while (timeSinceLastUpdate > TimePerFrame) {
+        timeSinceLastUpdate -= TimePerFrame;
+        processEvents();
+        onUpdate(TimePerFrame);
+      }
+    }
+    // nobody reads the stream anymore, the render is over
+    if (m_streamer && m_streamer->isClosed()) {
+      m_done = true;
     }
 
     if (fpsStopWatch.getElapsedTime() >= TimeSpan::seconds(1)) {
@@ -37,22 +58,205 @@ void Application::run() {
       frames = 0;
     }
 
+    m_interpolation =
+        offline ? 1.f : std::min(timeSinceLastUpdate.getTotalSeconds() / TimePerFrame.getTotalSeconds(), 1.f);
     onRender();
     frames++;
     m_window.display();
+
+    if (m_settings.frames > 0 && m_frames >= m_settings.frames) {
+      m_done = true;
+    }
   }
 
+  if (m_settings.frames > 0) {
+    if (!m_window.isSoftware()) {
+      glFinish();
+    }
+    auto elapsed = runStopWatch.getElapsedTime().getTotalMilliseconds();
+    std::cout << "Rendered " << m_frames << " frames in " << elapsed << " ms ("
+              << elapsed / static_cast<float>(std::max(m_frames, 1)) << " ms/frame)\n";
+  }
+
+  closeOutputs();
   onExit();
 }
 
+void Application::openOutputs(int width, int height, const std::uint8_t *palette, int numColors) {
+  const auto &settings = m_settings.stream;
+  if (!settings.path.empty()) {
+    try {
+      m_streamer = std::make_unique<FrameStreamer>(settings, width, height, palette, numColors, TicksPerSecond);
+    } catch (const std::exception &e) {
+      std::cerr << e.what() << '\n';
+      m_done = true;
+    }
+  }
+  if (!m_settings.record.empty()) {
+    startRecording(m_settings.record, width, height, palette, numColors);
+    if (!m_recording) {
+      m_done = true;
+    }
+  }
+  if (!m_settings.frameBus.empty()) {
+    try {
+      m_frameBus = std::make_unique<FrameBusPublisher>(m_settings.frameBus, width, height, palette, numColors);
+      std::cout << "Publishing frames to the shared memory object " << m_settings.frameBus << '\n';
+    } catch (const std::exception &e) {
+      std::cerr << e.what() << '\n';
+      m_done = true;
+    }
+  }
+}
+
+void Application::writeOutputs(const std::uint8_t *image, int width, int height) {
+  if (m_streamer) {
+    m_streamer->push(image, width, height);
+  }
+  if (m_recording) {
+    m_recording->addFrame(image, width, height);
+  }
+  if (m_frameBus) {
+    m_frameBus->publish(image, width, height);
+  }
+}
+
+void Application::startRecording(const std::string &path, int width, int height, const std::uint8_t *palette,
+                                 int numColors) {
+  try {
+    m_recording = std::make_unique<FireRecordingWriter>(path, width, height, palette, numColors, TicksPerSecond);
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << '\n';
+  }
+}
+
+void Application::stopRecording() {
+  if (!m_recording)
+    return;
+  const auto path = m_recording->getPath();
+  const auto stats = m_recording->getStats();
+  // the destructor writes the index
+  m_recording.reset();
+  std::cout << "Recording saved to " << path << ": " << stats.frames << " frames, "
+            << static_cast<double>(stats.bytes) / 1e6 << " MB ("
+            << static_cast<double>(stats.rawBytes) / static_cast<double>(std::max<std::uint64_t>(stats.bytes, 1))
+            << ":1), " << stats.encodeTime / static_cast<double>(std::max<std::uint64_t>(stats.frames, 1))
+            << " ms/frame\n";
+}
+
+void Application::openPlayback() {
+  if (m_settings.play.empty())
+    return;
+  try {
+    m_player = std::make_unique<FireRecordingPlayer>(m_settings.play);
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << '\n';
+    m_player.reset();
+    m_done = true;
+  }
+}
+
+bool Application::seekPlayback(int frame) {
+  try {
+    m_player->seek(frame);
+    return true;
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << ", the playback stops\n";
+    m_player.reset();
+    return false;
+  }
+}
+
+void Application::loadSnapshot(FireSimulation &fire) {
+  if (m_settings.loadSnapshot.empty())
+    return;
+  try {
+    FireSnapshot::load(fire, m_settings.loadSnapshot);
+    std::cout << "Snapshot " << m_settings.loadSnapshot << " restored at tick " << fire.getTick() << '\n';
+  } catch (const std::exception &e) {
+    // a kiosk still shows a fire, it starts from scratch
+    std::cerr << e.what() << '\n';
+  }
+}
+
+void Application::saveSnapshot(const FireSimulation &fire, const std::string &path) {
+  try {
+    FireSnapshot::save(fire, path);
+    std::cout << "Snapshot saved to " << path << " at tick " << fire.getTick() << '\n';
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << '\n';
+  }
+}
+
+bool Application::setWadPalette(int palette, int lightLevel) {
+  if (!m_wadPalettes)
+    return false;
+  try {
+    const auto ramp = m_wadPalettes->getFireRamp(palette, lightLevel, FirePalette::Colors, FirePalette::NumColors);
+    std::copy(ramp.begin(), ramp.end(), m_palette.begin());
+    m_wadPalette = palette;
+    m_wadLightLevel = lightLevel;
+    return true;
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << '\n';
+    return false;
+  }
+}
+
+void Application::openWad() {
+  if (m_settings.wad.empty())
+    return;
+  try {
+    m_wad = std::make_unique<Wad>(m_settings.wad);
+    m_wadPalettes = std::make_unique<WadPalettes>(*m_wad);
+    if (m_wadPalettes->getPaletteCount() == 0) {
+      std::cerr << m_settings.wad << " has no PLAYPAL lump, the built-in palette is used\n";
+      m_wadPalettes.reset();
+      m_wad.reset();
+      return;
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << ", the built-in palette is used\n";
+    m_wadPalettes.reset();
+    m_wad.reset();
+    return;
+  }
+  if (setWadPalette(m_settings.wadPalette, m_settings.wadLightLevel)) {
+    std::cout << "Palette " << m_wadPalette << ", light level " << m_wadLightLevel << " of " << m_settings.wad << '\n';
+  }
+}
+
+void Application::closeOutputs() {
+  stopRecording();
+  if (m_frameBus) {
+    const auto stats = m_frameBus->getStats();
+    m_frameBus.reset();
+    std::cout << "Frame bus: " << stats.published << " frames published, "
+              << stats.publishTime / static_cast<double>(std::max<std::uint64_t>(stats.published, 1))
+              << " ms/frame\n";
+  }
+  if (!m_streamer)
+    return;
+  m_streamer->finish();
+  auto stats = m_streamer->getStats();
+  m_streamer.reset();
+  std::cout << "Stream: " << stats.pushed << " frames queued, " << stats.dropped << " dropped, "
+            << static_cast<double>(stats.bytes) / 1e6 << " MB at " << stats.throughput << " MB/s, producer blocked "
+            << stats.blockedTime << " ms\n";
+}
+
 void Application::processEvents() {
   SDL_Event event;
   while (m_window.pollEvent(event)) {
-    ImGui_ImplSDL2_ProcessEvent(&event);
+    // the software path has no ImGui to capture the inputs
+    const bool imGui = !m_window.isSoftware();
+    if (imGui && !m_window.isHeadless()) {
+      ImGui_ImplSDL2_ProcessEvent(&event);
+    }
     if (event.type == SDL_QUIT) {
       m_done = true;
     } else {
-      if (!ImGui::GetIO().WantTextInput && !ImGui::GetIO().WantCaptureMouse) {
+      if (!imGui || (!ImGui::GetIO().WantTextInput && !ImGui::GetIO().WantCaptureMouse)) {
         onEvent(event);
       }
     }
@@ -60,7 +264,8 @@ void Application::processEvents() {
 }
 
 void Application::onInit() {
-  m_window.init();
+  m_window.init(m_settings.window);
+  openWad();
 }
 
 void Application::onExit() {
@@ -70,15 +275,21 @@ void Application::onUpdate(const TimeSpan &) {
 }
 
 void Application::onRender() {
+  if (m_window.isSoftware()) {
+    m_frames++;
+    return;
+  }
+
   // Render dear imgui
   ImGui_ImplOpenGL3_NewFrame();
-  ImGui_ImplSDL2_NewFrame(m_window.getNativeHandle());
+  m_window.newImGuiFrame();
   ImGui::NewFrame();
 
   onImGuiRender();
 
   // imgui render
   ImGui::Render();
+  DebugGroup group("ImGui");
   ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
   m_frames++;
@@ -1,12 +1,55 @@
 #ifndef COLORCYCLING__APPLICATION_H
 #define COLORCYCLING__APPLICATION_H
 
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "FirePalette.h"
+#include "FireRecording.h"
+#include "FireSimulation.h"
+#include "FrameBus.h"
+#include "FrameStreamer.h"
 #include "TimeSpan.h"
+#include "Wad.h"
 #include "Window.h"
 
+struct ApplicationSettings {
+  WindowSettings window;
+  /// Number of frames to render before quitting, 0 to run until the window is closed.
+  int frames{0};
+  /// Raw video output fed with the simulation ticks, disabled when its path is empty.
+  StreamSettings stream;
+  /// Session recording written with every simulation tick, disabled when empty.
+  std::string record;
+  /// Session recording played back instead of running the simulation, disabled when empty.
+  std::string play;
+  /// Snapshot restored into the simulation at startup, to start from a developed fire. Disabled when empty.
+  std::string loadSnapshot;
+  /// Snapshot of the simulation written when quitting. Disabled when empty.
+  std::string saveSnapshot;
+  /// Name of the shared memory object the ticks are published to for other processes, disabled when empty.
+  std::string frameBus;
+  /// Size of the fire of the software path, 0 for its default size.
+  int fireWidth{0};
+  int fireHeight{0};
+  /// Number of processes simulating column slices of the fire of the software path, 0 to simulate it in this one.
+  int shards{0};
+  /// WAD the fire palette is taken from (PLAYPAL and COLORMAP lumps), the built-in palette when empty.
+  std::string wad;
+  /// PLAYPAL palette of the WAD, 0 is the normal one, the next ones the damage, pickup and radiation suit tints.
+  int wadPalette{0};
+  /// COLORMAP light ramp darkening the fire, 0 is full bright.
+  int wadLightLevel{0};
+  /// Draws the fire of the software path in the terminal with 24-bit colors, for servers without a display.
+  bool terminal{false};
+  /// Frames drawn per second at most in the terminal, each one costs bandwidth on a remote session.
+  int terminalFps{30};
+};
+
 class Application {
 public:
-  Application();
+  explicit Application(ApplicationSettings settings = {});
   virtual ~Application();
 
   void run();
@@ -19,14 +62,46 @@ protected:
   virtual void onImGuiRender();
   virtual void onEvent(SDL_Event& event);
 
+  /// Opens the outputs the settings ask for, the subclasses then write one image per simulation tick.
+  void openOutputs(int width, int height, const std::uint8_t *palette, int numColors);
+  /// Feeds the video stream, the session recording and the frame bus with the image of a tick.
+  void writeOutputs(const std::uint8_t *image, int width, int height);
+  void startRecording(const std::string &path, int width, int height, const std::uint8_t *palette, int numColors);
+  void stopRecording();
+  /// Opens the recording to play back when the settings ask for one, the first tick shows its first frame.
+  void openPlayback();
+  /// Shows a frame of the recording played back, the playback stops when it cannot be decoded.
+  /// \return false when the playback stopped.
+  bool seekPlayback(int frame);
+  /// Restores the snapshot the settings ask for, the fire keeps its state when it cannot be read.
+  void loadSnapshot(FireSimulation &fire);
+  void saveSnapshot(const FireSimulation &fire, const std::string &path);
+  /// Replaces the colors of m_palette by a fire ramp of the WAD, they are kept when the WAD has no such palette.
+  bool setWadPalette(int palette, int lightLevel);
+
 private:
   void processEvents();
+  void closeOutputs();
+  void openWad();
 
 protected:
+  ApplicationSettings m_settings;
   Window m_window;
   bool m_done{false};
   float m_fps{0};
   int m_frames{0};
+  /// Fraction of a simulation step elapsed since the last onUpdate, in [0, 1], to blend consecutive ticks.
+  float m_interpolation{1};
+  std::unique_ptr<FrameStreamer> m_streamer;
+  std::unique_ptr<FireRecordingWriter> m_recording;
+  std::unique_ptr<FireRecordingPlayer> m_player;
+  std::unique_ptr<FrameBusPublisher> m_frameBus;
+  /// Colors of the fire intensities, the built-in ones or the ones of a WAD.
+  std::array<std::uint8_t, FirePalette::NumColors * 3> m_palette{};
+  std::unique_ptr<Wad> m_wad;
+  std::unique_ptr<WadPalettes> m_wadPalettes;
+  int m_wadPalette{0};
+  int m_wadLightLevel{0};
 };
 
 #endif//COLORCYCLING__APPLICATION_H
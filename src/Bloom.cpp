@@ -0,0 +1,253 @@
+#include "Bloom.h"
+#include <algorithm>
+#include <cassert>
+
+static const char *vertexShaderSource =
+    R"(#version 330 core
+out vec2 uv;
+void main()
+{
+  vec2 pos = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+  uv = pos;
+  gl_Position = vec4(pos * 2.0 - 1.0, 0.0, 1.0);
+})";
+
+// Averages the source texels covered by a destination texel, four bilinear taps a quarter of the destination texel
+// away from its center: 2x2 texels at half the resolution, 4x4 at a quarter when the chain starts lower, the taps
+// falling on the corners between texels. The bright pass keeps what is over the threshold. Drawn from a smaller level
+// into a bigger one it becomes a bilinear upsample.
+static const char *downsampleShaderSource =
+    R"(#version 330 core
+uniform sampler2D src_tex;
+uniform float threshold;
+uniform vec2 texel;
+in vec2 uv;
+out vec4 color;
+
+void main()
+{
+  vec3 c = texture(src_tex, uv + vec2(-texel.x, -texel.y)).rgb
+      + texture(src_tex, uv + vec2(texel.x, -texel.y)).rgb
+      + texture(src_tex, uv + vec2(-texel.x, texel.y)).rgb
+      + texture(src_tex, uv + vec2(texel.x, texel.y)).rgb;
+  color = vec4(max(c * 0.25 - threshold, 0.0), 1.0);
+})";
+
+// Bright pass of a chain starting at 1/8 of the resolution or lower: taps x taps bilinear taps two texels apart, each
+// on the corner between 2x2 texels, average the 2^(level + 1) texels a side covered by a destination texel. Kept
+// apart from the downsample shader, the loop makes the passes of the whole chain slower.
+static const char *boxShaderSource =
+    R"(#version 330 core
+uniform sampler2D src_tex;
+uniform float threshold;
+uniform int taps;
+uniform vec2 spacing;
+in vec2 uv;
+out vec4 color;
+
+void main()
+{
+  vec2 first = uv - spacing * (float(taps - 1) * 0.5);
+  vec3 c = vec3(0.0);
+  for (int y = 0; y < taps; ++y) {
+    for (int x = 0; x < taps; ++x) {
+      c += texture(src_tex, first + spacing * vec2(x, y)).rgb;
+    }
+  }
+  color = vec4(max(c / float(taps * taps) - threshold, 0.0), 1.0);
+})";
+
+// 9-tap gaussian in 5 fetches, the taps between two texels are merged by the linear filtering
+static const char *blurShaderSource =
+    R"(#version 330 core
+uniform sampler2D src_tex;
+uniform vec2 direction;
+in vec2 uv;
+out vec4 color;
+
+const float offsets[3] = float[](0.0, 1.3846153846, 3.2307692308);
+const float weights[3] = float[](0.2270270270, 0.3162162162, 0.0702702703);
+
+void main()
+{
+  vec2 step = direction / vec2(textureSize(src_tex, 0));
+  vec3 c = texture(src_tex, uv).rgb * weights[0];
+  for (int i = 1; i < 3; ++i) {
+    c += texture(src_tex, uv + step * offsets[i]).rgb * weights[i];
+    c += texture(src_tex, uv - step * offsets[i]).rgb * weights[i];
+  }
+  color = vec4(c, 1.0);
+})";
+
+static const char *compositeShaderSource =
+    R"(#version 330 core
+uniform sampler2D scene_tex;
+uniform sampler2D bloom_tex;
+uniform float intensity;
+in vec2 uv;
+out vec4 color;
+
+void main()
+{
+  vec3 scene = texelFetch(scene_tex, ivec2(gl_FragCoord.xy), 0).rgb;
+  color = vec4(scene + texture(bloom_tex, uv).rgb * intensity, 1.0);
+})";
+
+namespace {
+// the profiler reads its timings a few frames late
+constexpr int SettleFrames = 8;
+}
+
+Bloom::Bloom(int width, int height)
+    : m_width(width), m_height(height) {
+  createChain();
+
+  m_downsampleShader = std::make_unique<Shader>(vertexShaderSource, downsampleShaderSource);
+  m_boxShader = std::make_unique<Shader>(vertexShaderSource, boxShaderSource);
+  m_blurShader = std::make_unique<Shader>(vertexShaderSource, blurShaderSource);
+  m_compositeShader = std::make_unique<Shader>(vertexShaderSource, compositeShaderSource);
+  m_downsampleShader->setLabel("bloom downsample");
+  m_boxShader->setLabel("bloom box downsample");
+  m_blurShader->setLabel("bloom blur");
+  m_compositeShader->setLabel("bloom composite");
+  m_downsampleSrcHandle = m_downsampleShader->getUniformHandle("src_tex");
+  m_thresholdHandle = m_downsampleShader->getUniformHandle("threshold");
+  m_texelHandle = m_downsampleShader->getUniformHandle("texel");
+  m_boxSrcHandle = m_boxShader->getUniformHandle("src_tex");
+  m_boxThresholdHandle = m_boxShader->getUniformHandle("threshold");
+  m_tapsHandle = m_boxShader->getUniformHandle("taps");
+  m_spacingHandle = m_boxShader->getUniformHandle("spacing");
+  m_blurSrcHandle = m_blurShader->getUniformHandle("src_tex");
+  m_directionHandle = m_blurShader->getUniformHandle("direction");
+  m_sceneHandle = m_compositeShader->getUniformHandle("scene_tex");
+  m_bloomHandle = m_compositeShader->getUniformHandle("bloom_tex");
+  m_intensityHandle = m_compositeShader->getUniformHandle("intensity");
+  m_vao.setLabel("bloom fullscreen triangle");
+}
+
+const RenderTarget &Bloom::apply(const RenderTarget &source) {
+  assert(source.getWidth() == m_width && source.getHeight() == m_height);
+  assert(source.getTexture()->isSmooth());
+  // too small for a single level
+  if (m_maxLevels == 0)
+    return source;
+  m_vao.bind();
+
+  // down the chain: bright pass in the first level, then blur each level
+  for (auto i = m_firstLevel; i < m_maxLevels; ++i) {
+    auto &level = m_chain[i];
+    if (i == m_firstLevel && i >= 2) {
+      m_boxShader->setUniform(m_boxSrcHandle, *source.getTexture());
+      m_boxShader->setUniform(m_boxThresholdHandle, m_threshold);
+      m_boxShader->setUniform(m_tapsHandle, 1 << i);
+      m_boxShader->setUniform(m_spacingHandle, 2.f / glm::vec2(m_width, m_height));
+      drawPass(*level.image, *m_boxShader);
+    } else {
+      const auto &src = i == m_firstLevel ? *source.getTexture() : *m_chain[i - 1].image->getTexture();
+      m_downsampleShader->setUniform(m_downsampleSrcHandle, src);
+      m_downsampleShader->setUniform(m_thresholdHandle, i == m_firstLevel ? m_threshold : 0.f);
+      m_downsampleShader->setUniform(m_texelHandle,
+                                     0.25f / glm::vec2(level.image->getWidth(), level.image->getHeight()));
+      drawPass(*level.image, *m_downsampleShader);
+    }
+
+    m_blurShader->setUniform(m_blurSrcHandle, *level.image->getTexture());
+    m_blurShader->setUniform(m_directionHandle, glm::vec2(1, 0));
+    drawPass(*level.blur, *m_blurShader);
+    m_blurShader->setUniform(m_blurSrcHandle, *level.blur->getTexture());
+    m_blurShader->setUniform(m_directionHandle, glm::vec2(0, 1));
+    drawPass(*level.image, *m_blurShader);
+  }
+
+  // up the chain: each level is added to the one above, wider blurs end up with less weight per pixel
+  GL_CHECK(glEnable(GL_BLEND));
+  GL_CHECK(glBlendFunc(GL_ONE, GL_ONE));
+  m_downsampleShader->setUniform(m_thresholdHandle, 0.f);
+  for (auto i = m_maxLevels - 1; i > m_firstLevel; --i) {
+    const auto &src = *m_chain[i].image;
+    m_downsampleShader->setUniform(m_downsampleSrcHandle, *src.getTexture());
+    m_downsampleShader->setUniform(m_texelHandle, 0.5f / glm::vec2(src.getWidth(), src.getHeight()));
+    drawPass(*m_chain[i - 1].image, *m_downsampleShader);
+  }
+  GL_CHECK(glDisable(GL_BLEND));
+
+  m_compositeShader->setUniform(m_sceneHandle, *source.getTexture());
+  m_compositeShader->setUniform(m_bloomHandle, *m_chain[m_firstLevel].image->getTexture());
+  m_compositeShader->setUniform(m_intensityHandle, m_intensity);
+  drawPass(*m_output, *m_compositeShader);
+
+  VertexArray::unbind();
+  return *m_output;
+}
+
+void Bloom::adjust(float gpuTime) {
+  if (m_settleFrames > 0) {
+    --m_settleFrames;
+    return;
+  }
+  if (gpuTime <= 0)
+    return;
+
+  m_totalTime += gpuTime;
+  if (++m_evaluatedFrames < EvaluationFrames)
+    return;
+
+  // the gap between the two thresholds keeps the chain from oscillating between two lengths; the first level, at the
+  // highest resolution, is the one shed or restored
+  auto average = m_totalTime / static_cast<float>(m_evaluatedFrames);
+  auto firstLevel = m_firstLevel;
+  if (average > m_budget && m_firstLevel < m_maxLevels - 1) {
+    ++firstLevel;
+  } else if (average < m_budget * 0.5f && m_firstLevel > 0) {
+    --firstLevel;
+  }
+  if (firstLevel != m_firstLevel) {
+    m_firstLevel = firstLevel;
+    resetBudget();
+    return;
+  }
+  m_evaluatedFrames = 0;
+  m_totalTime = 0;
+}
+
+void Bloom::resetBudget() {
+  m_settleFrames = SettleFrames;
+  m_evaluatedFrames = 0;
+  m_totalTime = 0;
+}
+
+void Bloom::resize(int width, int height) {
+  if (width == m_width && height == m_height)
+    return;
+  m_width = width;
+  m_height = height;
+  createChain();
+  m_firstLevel = std::max(std::min(m_firstLevel, m_maxLevels - 1), 0);
+  resetBudget();
+}
+
+void Bloom::createChain() {
+  m_maxLevels = 0;
+  for (auto &level : m_chain) {
+    auto w = m_width >> (m_maxLevels + 1);
+    auto h = m_height >> (m_maxLevels + 1);
+    if (w < 2 || h < 2) {
+      level = {};
+      continue;
+    }
+    level.image = std::make_unique<RenderTarget>(w, h);
+    level.blur = std::make_unique<RenderTarget>(w, h);
+    level.image->getTexture()->setSmooth();
+    level.blur->getTexture()->setSmooth();
+    level.image->setLabel("bloom level");
+    level.blur->setLabel("bloom blur");
+    ++m_maxLevels;
+  }
+  m_output = std::make_unique<RenderTarget>(m_width, m_height);
+  m_output->setLabel("bloom output");
+}
+
+void Bloom::drawPass(RenderTarget &target, const Shader &shader) {
+  target.bind();
+  target.draw(PrimitiveType::Triangles, 0, 3, &shader);
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <array>
+#include <memory>
+#include "RenderTarget.h"
+#include "Shader.h"
+#include "VertexArray.h"
+
+/// Glow post-process: the bright parts of an image are downsampled through a chain of half, quarter... resolution
+/// targets, blurred at each level with a separable gaussian, added back up the chain and composited over the image.
+///
+/// The cost is dominated by the first levels, so the chain starts at a lower resolution, the bright pass sampling
+/// the image directly into a smaller level, when the measured GPU time goes over a budget, and higher again when
+/// there is room for it. The wide glow of the last levels stays.
+class Bloom {
+public:
+  static constexpr int MaxLevels = 5;
+
+  /// \param width: Specifies the width of the images to process.
+  /// \param height: Specifies the height of the images to process.
+  Bloom(int width, int height);
+
+  /// Changes the size of the images to process, the settings are kept.
+  void resize(int width, int height);
+
+  /// Applies the glow to the color texture of a target.
+  /// \param source: Specifies the image, its texture must be smooth: the bright pass averages it with bilinear taps.
+  /// \return the target holding the result, it has the size of the source; the source when it is too small for a level.
+  const RenderTarget &apply(const RenderTarget &source);
+
+  /// Adapts the number of levels to the budget.
+  /// \param gpuTime: Specifies the GPU time in milliseconds of a recent apply(), 0 if it is not known yet.
+  void adjust(float gpuTime);
+
+  /// Restarts the evaluation of the budget, when the measured frames may not have used the bloom.
+  void resetBudget();
+
+  void setBudget(float ms) noexcept { m_budget = ms; }
+  [[nodiscard]] float getBudget() const noexcept { return m_budget; }
+  void setThreshold(float threshold) noexcept { m_threshold = threshold; }
+  [[nodiscard]] float getThreshold() const noexcept { return m_threshold; }
+  void setIntensity(float intensity) noexcept { m_intensity = intensity; }
+  [[nodiscard]] float getIntensity() const noexcept { return m_intensity; }
+  [[nodiscard]] int getLevels() const noexcept { return m_maxLevels - m_firstLevel; }
+  /// Returns the first level of the chain, at 1 / 2^(level + 1) of the resolution of the images.
+  [[nodiscard]] int getFirstLevel() const noexcept { return m_firstLevel; }
+
+private:
+  struct Level {
+    // the blurred image, then the result of the levels below added to it
+    std::unique_ptr<RenderTarget> image;
+    // intermediate result of the horizontal blur pass
+    std::unique_ptr<RenderTarget> blur;
+  };
+
+  void createChain();
+  void drawPass(RenderTarget &target, const Shader &shader);
+
+private:
+  static constexpr int EvaluationFrames = 30;
+
+  int m_width;
+  int m_height;
+  std::array<Level, MaxLevels> m_chain{};
+  std::unique_ptr<RenderTarget> m_output{};
+  std::unique_ptr<Shader> m_downsampleShader{};
+  std::unique_ptr<Shader> m_boxShader{};
+  std::unique_ptr<Shader> m_blurShader{};
+  std::unique_ptr<Shader> m_compositeShader{};
+  Shader::UniformHandle m_downsampleSrcHandle{-1};
+  Shader::UniformHandle m_thresholdHandle{-1};
+  Shader::UniformHandle m_texelHandle{-1};
+  Shader::UniformHandle m_boxSrcHandle{-1};
+  Shader::UniformHandle m_boxThresholdHandle{-1};
+  Shader::UniformHandle m_tapsHandle{-1};
+  Shader::UniformHandle m_spacingHandle{-1};
+  Shader::UniformHandle m_blurSrcHandle{-1};
+  Shader::UniformHandle m_directionHandle{-1};
+  Shader::UniformHandle m_sceneHandle{-1};
+  Shader::UniformHandle m_bloomHandle{-1};
+  Shader::UniformHandle m_intensityHandle{-1};
+  VertexArray m_vao{};
+  // number of levels the chain can hold at the current size, the ones before the first level are skipped
+  int m_maxLevels{MaxLevels};
+  int m_firstLevel{0};
+  float m_budget{1.f};
+  float m_threshold{0.5f};
+  float m_intensity{1.f};
+  // frames to ignore until the GPU times reflect the current number of levels
+  int m_settleFrames{0};
+  int m_evaluatedFrames{0};
+  float m_totalTime{0};
+};
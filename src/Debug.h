@@ -2,8 +2,13 @@
 #include <cstdio>
 #include <iostream>
 #include <GL/glew.h>
+#include "GlCapabilities.h"
 
-#ifdef DEBUG
+#if defined(USE_GL_DEBUG_OUTPUT)
+// errors are reported asynchronously by the KHR_debug callback, no glGetError round-trip per call; a context
+// without KHR_debug falls back to glGetError after each call
+#define GL_CHECK(expr) do { (expr); if (!GlCapabilities::get().debugOutput) checkGlError(__FILE__, __LINE__, #expr); } while (false)
+#elif defined(DEBUG)
 #define GL_CHECK(expr) do { (expr); checkGlError(__FILE__, __LINE__, #expr); } while (false)
 #else
 #define GL_CHECK(expr) (expr)
@@ -45,3 +50,96 @@ static void checkGlError(const char* file, unsigned int line, const char* expr){
 
   std::cerr << "Error '" << name <<"' at " << file << ':' << line << " for expression '" << expr << "': " << desc << "\n";
 }
+
+static void GLAPIENTRY onGlDebugMessage(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei, const GLchar *message, const void *) {
+  const char *sourceName;
+  switch (source) {
+  case GL_DEBUG_SOURCE_API:sourceName = "API";
+    break;
+  case GL_DEBUG_SOURCE_WINDOW_SYSTEM:sourceName = "window system";
+    break;
+  case GL_DEBUG_SOURCE_SHADER_COMPILER:sourceName = "shader compiler";
+    break;
+  case GL_DEBUG_SOURCE_APPLICATION:sourceName = "application";
+    break;
+  default:sourceName = "other";
+    break;
+  }
+
+  const char *typeName;
+  switch (type) {
+  case GL_DEBUG_TYPE_ERROR:typeName = "error";
+    break;
+  case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR:typeName = "deprecated behavior";
+    break;
+  case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:typeName = "undefined behavior";
+    break;
+  case GL_DEBUG_TYPE_PERFORMANCE:typeName = "performance";
+    break;
+  case GL_DEBUG_TYPE_PORTABILITY:typeName = "portability";
+    break;
+  default:typeName = "other";
+    break;
+  }
+
+  const char *severityName;
+  switch (severity) {
+  case GL_DEBUG_SEVERITY_HIGH:severityName = "high";
+    break;
+  case GL_DEBUG_SEVERITY_MEDIUM:severityName = "medium";
+    break;
+  default:severityName = "low";
+    break;
+  }
+
+  std::cerr << "GL " << typeName << " (" << sourceName << ", severity " << severityName << ", id " << id << "): " << message << "\n";
+}
+
+/// Installs the KHR_debug callback, it has to be called after GlCapabilities::detect.
+/// Messages are delivered asynchronously: they name the failing call but not the line that issued it,
+/// the debug groups opened with DebugGroup tell which phase of the frame it belongs to.
+inline void installDebugOutput() {
+  if (!GlCapabilities::get().debugOutput) {
+#ifdef USE_GL_DEBUG_OUTPUT
+    std::cerr << "Warning: KHR_debug is not supported, GL errors are checked with glGetError after each call\n";
+#endif
+    return;
+  }
+  glEnable(GL_DEBUG_OUTPUT);
+  glDebugMessageCallback(onGlDebugMessage, nullptr);
+  // notifications and our own push/pop group messages are noise
+  glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
+  glDebugMessageControl(GL_DEBUG_SOURCE_APPLICATION, GL_DEBUG_TYPE_PUSH_GROUP, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+  glDebugMessageControl(GL_DEBUG_SOURCE_APPLICATION, GL_DEBUG_TYPE_POP_GROUP, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+}
+
+/// Names a GL object in debug messages and in frame debuggers, does nothing without debug output.
+/// \param identifier: Specifies the namespace of the object (GL_TEXTURE, GL_BUFFER, GL_PROGRAM...).
+/// \param name: Specifies the object, it must have been bound or created with DSA before.
+inline void labelObject(GLenum identifier, GLuint name, const char *label) {
+  if (!GlCapabilities::get().debugOutput || name == 0)
+    return;
+  glObjectLabel(identifier, name, -1, label);
+}
+
+/// Scopes the GL commands of a phase of the frame in a named debug group.
+class DebugGroup {
+public:
+  explicit DebugGroup(const char *name) : m_active(GlCapabilities::get().debugOutput) {
+    if (m_active) {
+      glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+    }
+  }
+
+  ~DebugGroup() {
+    if (m_active) {
+      glPopDebugGroup();
+    }
+  }
+
+  DebugGroup(const DebugGroup &) = delete;
+  DebugGroup &operator=(const DebugGroup &) = delete;
+
+private:
+  bool m_active;
+};
@@ -1,17 +1,29 @@
 #include "DoomFireApplication.h"
+#include "FirePalette.h"
+#include "ShaderCache.h"
 #include "Util.h"
 #include <GL/glew.h>
 #include <SDL.h>
-#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <ctime>
 #include <imgui.h>
 #include <iostream>
+#include <string>
 #include <glm/vec2.hpp>
 #include <glm/mat4x4.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 static const char *vertexShaderSource =
     R"(#version 330 core
-uniform mat4 xform;
+layout (std140) uniform Frame {
+  mat4 xform;
+  float blend;
+};
 layout (location = 0) in vec4 attr_vertex;
 out vec2 uv;
 void main()
@@ -20,17 +32,50 @@ void main()
    uv = (attr_vertex.xy * vec2(0.5, -0.5) + 0.5);
 })";
 
-static const char *fragmentShaderSource =
+// reference lookup: the index is read as a normalized float and used as a coordinate into the palette
+static const char *floatFragmentShaderSource =
     R"(#version 330 core
 out vec4 FragColor;
 in vec2 uv;
+layout (std140) uniform Frame {
+  mat4 xform;
+  float blend;
+};
 uniform sampler2D img_tex;
+uniform sampler2D prev_img_tex;
 uniform sampler1D pal_tex;
 void main()
 {
+  float size = float(textureSize(pal_tex, 0));
   float cidx = texture(img_tex, uv).x;
-  vec3 color = texture(pal_tex, cidx).xyz;
-  FragColor.xyz = color;
+  float prev_cidx = texture(prev_img_tex, uv).x;
+  vec3 color = texture(pal_tex, (cidx * 255.0 + 0.5) / size).xyz;
+  vec3 prev_color = texture(pal_tex, (prev_cidx * 255.0 + 0.5) / size).xyz;
+  FragColor.xyz = mix(prev_color, color, blend);
+  FragColor.a = 1.0;
+})";
+
+// exact lookup: the index is fetched as an integer and addresses the palette texel directly
+static const char *fragmentShaderSource =
+    R"(#version 330 core
+out vec4 FragColor;
+in vec2 uv;
+layout (std140) uniform Frame {
+  mat4 xform;
+  float blend;
+};
+uniform usampler2D img_tex;
+uniform usampler2D prev_img_tex;
+uniform sampler1D pal_tex;
+void main()
+{
+  ivec2 size = textureSize(img_tex, 0);
+  ivec2 texel = min(ivec2(uv * vec2(size)), size - 1);
+  uint cidx = texelFetch(img_tex, texel, 0).x;
+  uint prev_cidx = texelFetch(prev_img_tex, texel, 0).x;
+  vec3 color = texelFetch(pal_tex, int(cidx), 0).xyz;
+  vec3 prev_color = texelFetch(pal_tex, int(prev_cidx), 0).xyz;
+  FragColor.xyz = mix(prev_color, color, blend);
   FragColor.a = 1.0;
 })";
 
@@ -38,6 +83,28 @@ struct Vertex {
   glm::vec2 pos;
 };
 
+// per-frame data, laid out as the std140 Frame block of the vertex shader
+struct FrameUniforms {
+  glm::mat4 xform{1};
+  // weight of the latest simulation tick against the previous one
+  float blend{1};
+  float padding[3]{};
+};
+
+static constexpr unsigned int FrameBlockBinding = 0;
+
+// the simulation ticks at 60 Hz, the GIF keeps one tick out of 3 and shows each for 5 hundredths of a second
+static constexpr int GifTickInterval = 3;
+static constexpr int GifFrameDelay = 5;
+
+// names the captures after the time they start, in the working directory
+static std::string getCapturePath(const char *extension) {
+  char name[32];
+  auto now = std::time(nullptr);
+  std::strftime(name, sizeof(name), "doom_fire_%Y%m%d_%H%M%S", std::localtime(&now));
+  return std::string(name) + extension;
+}
+
 enum class VertexAttributeType {
   Byte = GL_BYTE,
   UnsignedByte = GL_UNSIGNED_BYTE,
@@ -67,45 +134,6 @@ static constexpr unsigned int indices[] = {
     1, 2, 3 // second triangle
 };
 
-const std::uint8_t palette[] = {
-    0x07, 0x07, 0x07,
-    0x1F, 0x07, 0x07,
-    0x2F, 0x0F, 0x07,
-    0x47, 0x0F, 0x07,
-    0x57, 0x17, 0x07,
-    0x67, 0x1F, 0x07,
-    0x77, 0x1F, 0x07,
-    0x8F, 0x27, 0x07,
-    0x9F, 0x2F, 0x07,
-    0xAF, 0x3F, 0x07,
-    0xBF, 0x47, 0x07,
-    0xC7, 0x47, 0x07,
-    0xDF, 0x4F, 0x07,
-    0xDF, 0x57, 0x07,
-    0xDF, 0x57, 0x07,
-    0xD7, 0x5F, 0x07,
-    0xD7, 0x5F, 0x07,
-    0xD7, 0x67, 0x0F,
-    0xCF, 0x6F, 0x0F,
-    0xCF, 0x77, 0x0F,
-    0xCF, 0x7F, 0x0F,
-    0xCF, 0x87, 0x17,
-    0xC7, 0x87, 0x17,
-    0xC7, 0x8F, 0x17,
-    0xC7, 0x97, 0x1F,
-    0xBF, 0x9F, 0x1F,
-    0xBF, 0x9F, 0x1F,
-    0xBF, 0xA7, 0x27,
-    0xBF, 0xA7, 0x27,
-    0xBF, 0xAF, 0x2F,
-    0xB7, 0xAF, 0x2F,
-    0xB7, 0xB7, 0x2F,
-    0xB7, 0xB7, 0x37,
-    0xCF, 0xCF, 0x6F,
-    0xDF, 0xDF, 0x9F,
-    0xEF, 0xEF, 0xC7,
-    0xFF, 0xFF, 0xFF};
-
 static int
 drawPalette(const std::uint8_t *pal, int numColors = 256, int numColorsByRow = 13, const ImVec2 &size = ImVec2(12, 12),
             const ImVec2 &spacing = ImVec2(2, 2)) {
@@ -140,11 +168,13 @@ drawPalette(const std::uint8_t *pal, int numColors = 256, int numColorsByRow = 1
 }
 
 void DoomFireApplication::reset() {
-  // Set whole screen to 0 (color: 0x07,0x07,0x07)
-  memset(m_image.data(), 0, m_image.size());
-
-  // Set bottom line to 37 (color white: 0xFF,0xFF,0xFF)
-  memset(m_image.data() + (FIRE_HEIGHT - 1) * FIRE_WIDTH, 36, FIRE_WIDTH);
+  m_fire.reset();
+  for (auto &fire : m_instanceFires) {
+    fire.reset();
+  }
+  if (m_gpuFire) {
+    m_gpuFire->reset();
+  }
 }
 
 void DoomFireApplication::onInit() {
@@ -157,13 +187,15 @@ void DoomFireApplication::onInit() {
   m_shader = std::make_unique<Shader>(vertexShaderSource, fragmentShaderSource);
   m_vao = std::make_unique<VertexArray>();
 
-  // bind the Vertex Array Object first, then bind and set vertex buffer(s), and then configure vertex attributes(s).
-  m_vao->bind();
+  m_floatShader = std::make_unique<Shader>(vertexShaderSource, floatFragmentShaderSource);
+
   m_vbo->buffer(sizeof(vertices), vertices);
   m_ebo->buffer(sizeof(indices), indices);
+  m_vao->setVertexBuffer(0, *m_vbo, 0, sizeof(Vertex));
+  m_vao->setElementBuffer(*m_ebo);
 
   VertexAttribute attributes[]{
-      "attr_vertex", 2, VertexAttributeType::Float, false, sizeof(Vertex)
+      "attr_vertex", 2, VertexAttributeType::Float, false, offsetof(Vertex, pos)
   };
 
   for (auto info : attributes) {
@@ -171,24 +203,111 @@ void DoomFireApplication::onInit() {
     if (loc == -1)
       continue;
 
-    GL_CHECK(glEnableVertexAttribArray(loc));
-    GL_CHECK(glVertexAttribPointer(loc,
-                                   info.size,
-                                   static_cast<GLenum>(info.type),
-                                   info.normalized ? GL_TRUE : GL_FALSE,
-                                   info.offset,
-                                   nullptr));
+    m_vao->setAttribute(loc, 0, info.size, static_cast<GLenum>(info.type), info.normalized, info.offset);
   }
 
-  VertexArray::unbind();
-  VertexBuffer::unbind(VertexBuffer::Type::Array);
-  VertexBuffer::unbind(VertexBuffer::Type::Element);
+  // rows of the index image are not 4-byte aligned when the width is odd
+  GL_CHECK(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
 
-  m_img_tex = std::make_unique<Texture>(Texture::Format::Alpha, FIRE_WIDTH, FIRE_HEIGHT, nullptr);
-  m_pal_tex = std::make_unique<Texture>(Texture::Format::Rgb, 256, palette);
+  m_pal_tex = std::make_unique<Texture>(Texture::Format::Rgb, FirePalette::NumColors, m_palette.data());
+
+  for (auto lookup : {PaletteLookup::Float, PaletteLookup::Integer}) {
+    auto shader = getShader(lookup);
+    shader->setUniform(shader->getUniformHandle("pal_tex"), *m_pal_tex);
+  }
 
-  m_shader->setUniform("img_tex", *m_img_tex);
-  m_shader->setUniform("pal_tex", *m_pal_tex);
+  m_frameUbo = std::make_unique<UniformBuffer>(sizeof(FrameUniforms));
+  m_frameUbo->update(FrameUniforms{});
+  m_frameUbo->bindBase(FrameBlockBinding);
+  m_shader->setUniformBlock("Frame", FrameBlockBinding);
+  m_floatShader->setUniformBlock("Frame", FrameBlockBinding);
+
+  m_shader->setLabel("fire integer lookup");
+  m_floatShader->setLabel("fire float lookup");
+  m_vbo->setLabel("fire quad vertices");
+  m_ebo->setLabel("fire quad indices");
+  m_vao->setLabel("fire quad");
+  m_pal_tex->setLabel("palette");
+  m_frameUbo->setLabel("frame uniforms");
+
+  m_profiler = std::make_unique<GpuProfiler>();
+  m_simulationPhase = m_profiler->addPhase("simulation");
+  m_uploadPhase = m_profiler->addPhase("upload");
+  m_drawPhase = m_profiler->addPhase("draw");
+  m_imguiPhase = m_profiler->addPhase("ImGui");
+  m_bloomPhase = m_profiler->addPhase("bloom");
+
+  // a snapshot may have been saved at another resolution
+  loadSnapshot(m_fire);
+  createFireResources(m_fire.getWidth(), m_fire.getHeight());
+  openOutputs(FIRE_WIDTH, FIRE_HEIGHT, m_palette.data(), FirePalette::NumColors);
+  openPlayback();
+
+  m_instanceRenderer = std::make_unique<FireInstanceRenderer>(INSTANCE_FIRE_WIDTH, INSTANCE_FIRE_HEIGHT, INSTANCE_LAYERS, MAX_INSTANCES, *m_pal_tex);
+  m_instanceFires.reserve(INSTANCE_LAYERS);
+  for (auto i = 0; i < INSTANCE_LAYERS; ++i) {
+    // each layer burns differently
+    m_instanceFires.emplace_back(INSTANCE_FIRE_WIDTH, INSTANCE_FIRE_HEIGHT, static_cast<std::uint32_t>(i + 1) * FireSimulation::DefaultSeed);
+  }
+
+  int w, h;
+  m_window.getDrawableSize(w, h);
+  m_target = std::make_unique<RenderTarget>(m_window.getFramebuffer(), w, h);
+  reshape(w, h);
+
+  const auto &shaderStats = ShaderCache::get().getStats();
+  std::cout << "Shaders: " << shaderStats.hits << " loaded from cache in " << shaderStats.loadTime << " ms, "
+            << shaderStats.misses << " compiled in " << shaderStats.compileTime << " ms\n";
+}
+
+void DoomFireApplication::onExit() {
+  if (!m_settings.saveSnapshot.empty()) {
+    saveSnapshot(m_fire, m_settings.saveSnapshot);
+  }
+  Application::onExit();
+}
+
+void DoomFireApplication::createFireResources(int width, int height) {
+  m_fire.resize(width, height);
+
+  for (auto lookup : {PaletteLookup::Float, PaletteLookup::Integer}) {
+    auto format = lookup == PaletteLookup::Integer ? Texture::Format::Index : Texture::Format::Alpha;
+    auto i = static_cast<int>(lookup);
+    m_img_tex[i] = std::make_unique<Texture>(format, width, height, m_fire.getImage());
+    m_prev_img_tex[i] = std::make_unique<Texture>(format, width, height, m_fire.getImage());
+    m_img_tex[i]->setLabel(lookup == PaletteLookup::Integer ? "fire image (integer)" : "fire image (float)");
+    m_prev_img_tex[i]->setLabel(lookup == PaletteLookup::Integer ? "previous fire image (integer)" : "previous fire image (float)");
+    bindIndexTextures(lookup);
+  }
+
+  // the palette is resolved once per fire pixel in this target, then the result is upscaled to the window
+  m_fireTarget = std::make_unique<RenderTarget>(width, height);
+  m_fireTarget->setLabel("fire target");
+  // the bloom averages it with bilinear taps, the blit and the readback copy its texels
+  m_fireTarget->getTexture()->setSmooth();
+
+  // the GPU fire cannot be resampled without reading it back, it starts over
+  m_gpuFire = std::make_unique<GpuFireSimulation>(width, height);
+  if (m_backend == SimulationBackend::Gpu) {
+    m_shader->setUniform(m_shader->getUniformHandle("img_tex"), m_gpuFire->getTexture());
+    m_shader->setUniform(m_shader->getUniformHandle("prev_img_tex"), m_gpuFire->getPreviousTexture());
+  }
+
+  if (m_bloom) {
+    m_bloom->resize(width, height);
+  } else {
+    m_bloom = std::make_unique<Bloom>(width, height);
+  }
+}
+
+void DoomFireApplication::applyResolutionScale() {
+  // even sizes keep the aspect ratio of the full resolution
+  auto scale = m_resolution.getScale();
+  auto width = std::max(2, static_cast<int>(std::lround(FIRE_WIDTH * scale / 2)) * 2);
+  auto height = std::max(2, static_cast<int>(std::lround(FIRE_HEIGHT * scale / 2)) * 2);
+  if (width == m_fire.getWidth() && height == m_fire.getHeight())
+    return;
+  createFireResources(width, height);
 }
 
 int width = 1280;
@@ -200,7 +319,7 @@ void DoomFireApplication::onEvent(SDL_Event &event) {
   switch (event.type)
   case SDL_WINDOWEVENT: {
     int w, h;
-    SDL_GL_GetDrawableSize(m_window.getNativeHandle(), &w, &h);
+    m_window.getDrawableSize(w, h);
     reshape(w, h);
     break;
   case SDL_KEYDOWN:
@@ -226,77 +345,457 @@ void DoomFireApplication::onEvent(SDL_Event &event) {
 }
 
 void DoomFireApplication::onRender() {
-  glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
-  glClear(GL_COLOR_BUFFER_BIT);
+  if (m_multiFire) {
+    {
+      DebugGroup group("draw");
+      GpuProfiler::Scope scope(*m_profiler, m_drawPhase);
+      renderInstances();
+    }
+    renderImGui();
+    m_instanceRenderer->endFrame();
+    return;
+  }
 
-  m_vao->bind();
-  m_target.draw(PrimitiveType::Triangles, ElementType::UnsignedInt, 6, m_shader.get());
-  m_vao->unbind();
+  {
+    DebugGroup group("draw");
+    GpuProfiler::Scope scope(*m_profiler, m_drawPhase);
+    FrameUniforms frame;
+    frame.blend = m_interpolate ? m_interpolation : 1.f;
+    m_frameUbo->update(frame);
+
+    m_fireTarget->bind();
+    m_vao->bind();
+    m_fireTarget->draw(PrimitiveType::Triangles, ElementType::UnsignedInt, 6, getShader(m_lookup));
+    VertexArray::unbind();
+  }
+
+  const RenderTarget *image = m_fireTarget.get();
+  if (m_bloomEnabled) {
+    DebugGroup group("bloom");
+    GpuProfiler::Scope scope(*m_profiler, m_bloomPhase);
+    image = &m_bloom->apply(*m_fireTarget);
+  }
+
+  {
+    DebugGroup group("draw");
+    GpuProfiler::Scope scope(*m_profiler, m_drawPhase);
+    m_target->bind();
+    glViewport(0, 0, m_windowWidth, m_windowHeight);
+    glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    image->blit(m_viewport, m_target->getHandle());
+  }
+
+  if (m_readback) {
+    DebugGroup group("readback");
+    m_readback->poll();
+    m_readback->capture(*image);
+  }
 
-  Application::onRender();
+  renderImGui();
+  m_simulationFrames++;
+
+  // a new sample is available at most once per frame, it is late by a few frames
+  if (m_profiler->getCollectedFrames() != m_profilerSamples || !m_profiler->isAvailable()) {
+    m_profilerSamples = m_profiler->getCollectedFrames();
+    if (m_bloomEnabled) {
+      m_bloom->adjust(m_profiler->getLatest(m_bloomPhase));
+    }
+    if (m_dynamicResolution) {
+      // the CPU simulation time is averaged over the frames since the last sample
+      auto frameTime = m_simulationTime / static_cast<float>(m_simulationFrames);
+      for (auto phase : {m_simulationPhase, m_uploadPhase, m_drawPhase, m_bloomPhase}) {
+        frameTime += m_profiler->getLatest(phase);
+      }
+      if (m_resolution.update(frameTime)) {
+        applyResolutionScale();
+      }
+    }
+    m_simulationTime = 0;
+    m_simulationFrames = 0;
+  }
+}
+
+void DoomFireApplication::renderImGui() {
+  {
+    GpuProfiler::Scope scope(*m_profiler, m_imguiPhase);
+    Application::onRender();
+  }
+  m_profiler->endFrame();
 }
 
 void DoomFireApplication::onUpdate(const TimeSpan &elapsed) {
   if (amountX != 0) {
-    width += amountX;
-    std::clamp(width, 10,  1280 * 2);
+    width = std::clamp(width + amountX, 10, 1280 * 2);
     reshape(width, height);
   }
 
   if (amountY != 0) {
-    height += amountY;
-    std::clamp(height, 10,  720 * 2);
+    height = std::clamp(height + amountY, 10, 720 * 2);
     reshape(width, height);
   }
 
+  if (m_multiFire) {
+    for (auto &fire : m_instanceFires) {
+      fire.update();
+    }
+    DebugGroup group("upload");
+    GpuProfiler::Scope scope(*m_profiler, m_uploadPhase);
+    for (std::size_t i = 0; i < m_instanceFires.size(); ++i) {
+      m_instanceRenderer->setLayer(static_cast<int>(i), m_instanceFires[i].getImage());
+    }
+    return;
+  }
+
+  if (m_backend == SimulationBackend::Gpu) {
+    // the ping-pong textures are the latest and the previous ticks
+    DebugGroup group("simulate");
+    GpuProfiler::Scope scope(*m_profiler, m_simulationPhase);
+    m_gpuFire->update();
+    m_shader->setUniform(m_shader->getUniformHandle("img_tex"), m_gpuFire->getTexture());
+    m_shader->setUniform(m_shader->getUniformHandle("prev_img_tex"), m_gpuFire->getPreviousTexture());
+    return;
+  }
+
   // Update palette buffer
-  doFire();
+  auto start = std::chrono::steady_clock::now();
+  // fast-forward skips frames, the player decodes them from the closest keyframe
+  if (m_player && (m_playbackPaused || seekPlayback(m_player->getFrame() + m_playbackSpeed))) {
+    m_fire.setImage(m_player->getImage(), m_player->getWidth(), m_player->getHeight());
+  } else {
+    m_fire.update();
+  }
+  m_simulationTime += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+  writeOutputs(m_fire.getImage(), m_fire.getWidth(), m_fire.getHeight());
+  if (m_gifRecorder && m_recordTicks++ % GifTickInterval == 0) {
+    m_gifRecorder->addFrame(m_fire.getImage(), m_fire.getWidth(), m_fire.getHeight());
+  }
+
+  DebugGroup group("upload");
+  GpuProfiler::Scope scope(*m_profiler, m_uploadPhase);
+  uploadImage(m_lookup);
+}
+
+void DoomFireApplication::renderInstances() {
+  // tile the instances in the letterboxed area, each one shows one of the layers
+  auto columns = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(m_instanceCount))));
+  auto rows = (m_instanceCount + columns - 1) / columns;
+  auto cellWidth = 2.f / static_cast<float>(columns);
+  auto cellHeight = 2.f / static_cast<float>(rows);
+  m_instances.clear();
+  for (auto i = 0; i < m_instanceCount; ++i) {
+    auto column = i % columns;
+    auto row = i / columns;
+    glm::vec4 rect(-1.f + static_cast<float>(column) * cellWidth, 1.f - static_cast<float>(row + 1) * cellHeight, cellWidth, cellHeight);
+    m_instances.push_back({rect, static_cast<float>(i % m_instanceRenderer->getLayers())});
+  }
+  m_instanceRenderer->setInstances(m_instances);
+
+  m_target->bind();
+  glViewport(0, 0, m_windowWidth, m_windowHeight);
+  glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
+  glClear(GL_COLOR_BUFFER_BIT);
+  glViewport(m_viewport.x, m_viewport.y, m_viewport.width, m_viewport.height);
+  m_instanceRenderer->draw(*m_target);
+  glViewport(0, 0, m_windowWidth, m_windowHeight);
+}
+
+void DoomFireApplication::setBackend(SimulationBackend backend) {
+  if (m_backend == backend)
+    return;
+  m_backend = backend;
+  if (backend == SimulationBackend::Gpu) {
+    // the simulation writes integer textures, only the integer lookup can read them
+    m_lookup = PaletteLookup::Integer;
+  } else {
+    bindIndexTextures(PaletteLookup::Integer);
+  }
+}
+
+Shader *DoomFireApplication::getShader(PaletteLookup lookup) const {
+  return lookup == PaletteLookup::Integer ? m_shader.get() : m_floatShader.get();
+}
+
+void DoomFireApplication::bindIndexTextures(PaletteLookup lookup) {
+  auto shader = getShader(lookup);
+  auto i = static_cast<int>(lookup);
+  shader->setUniform(shader->getUniformHandle("img_tex"), *m_img_tex[i]);
+  shader->setUniform(shader->getUniformHandle("prev_img_tex"), *m_prev_img_tex[i]);
+}
+
+void DoomFireApplication::uploadImage(PaletteLookup lookup) {
+  // the latest tick becomes the previous one, its texture receives the new image
+  auto i = static_cast<int>(lookup);
+  std::swap(m_img_tex[i], m_prev_img_tex[i]);
+  m_img_tex[i]->setData(m_fire.getWidth(), m_fire.getHeight(), m_fire.getImage());
+  bindIndexTextures(lookup);
+}
 
-  m_img_tex->setData(FIRE_WIDTH, FIRE_HEIGHT, m_image.data());
+void DoomFireApplication::benchmarkLookup() {
+  constexpr int NumDraws = 200;
+  m_fireTarget->bind();
+  m_vao->bind();
+  for (auto lookup : {PaletteLookup::Float, PaletteLookup::Integer}) {
+    // the latest tick without the swap of uploadImage: the previous tick of the lookup in use stays for the blend
+    m_img_tex[static_cast<int>(lookup)]->setData(m_fire.getWidth(), m_fire.getHeight(), m_fire.getImage());
+    bindIndexTextures(lookup);
+    // warm up, then time a batch of full screen draws
+    m_fireTarget->draw(PrimitiveType::Triangles, ElementType::UnsignedInt, 6, getShader(lookup));
+    glFinish();
+    auto start = std::chrono::steady_clock::now();
+    for (auto i = 0; i < NumDraws; ++i) {
+      m_fireTarget->draw(PrimitiveType::Triangles, ElementType::UnsignedInt, 6, getShader(lookup));
+    }
+    glFinish();
+    std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    m_lookupTimes[static_cast<int>(lookup)] = elapsed.count() / NumDraws;
+  }
+  VertexArray::unbind();
+  m_target->bind();
+  std::cout << "Palette lookup: float " << m_lookupTimes[0] << " ms/draw, integer " << m_lookupTimes[1] << " ms/draw\n";
 }
 
-void DoomFireApplication::reshape(int x, int y) const {
-  auto aspect = (float) x / (float) y;
-  auto fbaspect = (float) FIRE_WIDTH / (float) FIRE_HEIGHT;
+void DoomFireApplication::benchmarkSimulation() {
+  constexpr int NumTicks = 100;
+  for (auto backend : {SimulationBackend::Cpu, SimulationBackend::Gpu}) {
+    glFinish();
+    auto start = std::chrono::steady_clock::now();
+    for (auto i = 0; i < NumTicks; ++i) {
+      if (backend == SimulationBackend::Cpu) {
+        m_fire.update();
+        m_img_tex[static_cast<int>(PaletteLookup::Integer)]->setData(m_fire.getWidth(), m_fire.getHeight(), m_fire.getImage());
+      } else {
+        m_gpuFire->update();
+      }
+    }
+    glFinish();
+    std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    m_simulationTimes[static_cast<int>(backend)] = elapsed.count() / NumTicks;
+  }
+  m_target->bind();
+  std::cout << "Simulation: CPU " << m_simulationTimes[0] << " ms/tick (with upload), GPU " << m_simulationTimes[1] << " ms/tick\n";
+}
 
-  glViewport(0, 0, x, y);
+void DoomFireApplication::setReadback(bool enabled) {
+  if (!enabled) {
+    m_readback.reset();
+    return;
+  }
+  m_readback = std::make_unique<FrameReadback>([this](const FrameReadback::Frame &frame) {
+    std::uint64_t sum = 0;
+    for (std::size_t i = 0; i < frame.pixels.size(); i += 4) {
+      sum += frame.pixels[i] + frame.pixels[i + 1] + frame.pixels[i + 2];
+    }
+    const auto numValues = std::max<std::size_t>(frame.pixels.size() / 4 * 3, 1);
+    m_readbackBrightness = static_cast<float>(static_cast<double>(sum) / static_cast<double>(numValues) / 255.0);
+  });
+}
+
+void DoomFireApplication::setGifRecording(bool enabled) {
+  if (!enabled) {
+    if (!m_gifRecorder)
+      return;
+    const auto path = m_gifRecorder->getPath();
+    // the destructor waits for the queued frames
+    m_gifRecorder.reset();
+    std::cout << "GIF recording saved to " << path << '\n';
+    return;
+  }
 
-  glm::vec3 vaspect(1, 1, 1);
-  if (aspect > fbaspect) {
-    vaspect[0] = fbaspect / aspect;
-  } else if (fbaspect > aspect) {
-    vaspect[1] = aspect / fbaspect;
+  try {
+    // the animation keeps the full resolution when the dynamic resolution shrinks the fire
+    m_gifRecorder = std::make_unique<GifRecorder>(getCapturePath(".gif"), FIRE_WIDTH, FIRE_HEIGHT, m_palette.data(),
+                                                  FirePalette::NumColors, GifFrameDelay);
+    m_recordTicks = 0;
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << '\n';
   }
+}
+
+void DoomFireApplication::setSessionRecording(bool enabled) {
+  if (!enabled) {
+    stopRecording();
+    return;
+  }
+  // the recording keeps the full resolution when the dynamic resolution shrinks the fire
+  startRecording(getCapturePath(".dfr"), FIRE_WIDTH, FIRE_HEIGHT, m_palette.data(), FirePalette::NumColors);
+}
+
+void DoomFireApplication::renderPlayback() {
+  auto frame = m_player->getFrame();
+  if (ImGui::SliderInt("Frame", &frame, 0, m_player->getFrameCount() - 1) && !seekPlayback(frame))
+    return;
+  ImGui::Checkbox("Pause", &m_playbackPaused);
+  ImGui::SameLine();
+  ImGui::SliderInt("Speed", &m_playbackSpeed, 1, 16);
+  ImGui::Text("%d frame(s) decoded by the last seek, keyframe every %d", m_player->getDecodedFrames(),
+              m_player->getKeyframeInterval());
+}
 
-  auto xform = glm::scale(glm::mat4(1), vaspect);
-  m_shader->setUniform("xform", xform);
+void DoomFireApplication::reshape(int x, int y) {
+  m_windowWidth = x;
+  m_windowHeight = y;
+  // laid out at full resolution, the fire keeps its size on screen when the resolution scale changes
+  m_viewport = RenderTarget::letterbox(FIRE_WIDTH, FIRE_HEIGHT, x, y, m_integerScale);
 }
 
 void DoomFireApplication::onImGuiRender() {
   ImGui::Begin("Info");
   ImGui::Text("%.2f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+  if (ImGui::CollapsingHeader("GPU time", ImGuiTreeNodeFlags_DefaultOpen)) {
+    if (!m_profiler->isAvailable()) {
+      ImGui::Text("timer queries are not supported");
+    }
+    for (GpuProfiler::Phase phase = 0; phase < static_cast<GpuProfiler::Phase>(m_profiler->getPhaseCount()); ++phase) {
+      const auto &history = m_profiler->getHistory(phase);
+      char overlay[32];
+      std::snprintf(overlay, sizeof(overlay), "avg %.3f ms", m_profiler->getAverage(phase));
+      ImGui::PlotLines(m_profiler->getName(phase).c_str(), history.data(), static_cast<int>(history.size()),
+                       static_cast<int>(m_profiler->getHistoryOffset()), overlay, 0.f, FLT_MAX, ImVec2(0, 40));
+    }
+  }
   if (ImGui::Button("Reset")) {
     reset();
   }
-  drawPalette(palette, 37);
-  ImGui::End();
-}
-
-void DoomFireApplication::spreadFire(int src) {
-  auto pixel = m_image[src];
-  if (pixel == 0) {
-    m_image[src - FIRE_WIDTH] = 0;
-  } else {
-    auto randIdx = static_cast<int>(3.0f * static_cast<float>(rand()) / RAND_MAX);
-    auto dst = src - randIdx + 1;
-    m_image[dst - FIRE_WIDTH] = pixel - (randIdx & 1);
+  ImGui::SameLine();
+  if (ImGui::Button("Save snapshot")) {
+    saveSnapshot(m_fire, getCapturePath(".snap"));
   }
-}
-
-void DoomFireApplication::doFire() {
-  for (auto x = 0; x < FIRE_WIDTH; x++) {
-    for (auto y = 1; y < FIRE_HEIGHT; y++) {
-      spreadFire(y * FIRE_WIDTH + x);
+  auto backend = static_cast<int>(m_backend);
+  ImGui::RadioButton("CPU simulation", &backend, static_cast<int>(SimulationBackend::Cpu));
+  ImGui::SameLine();
+  ImGui::RadioButton("GPU simulation", &backend, static_cast<int>(SimulationBackend::Gpu));
+  setBackend(static_cast<SimulationBackend>(backend));
+  if (ImGui::Button("Benchmark simulation")) {
+    benchmarkSimulation();
+  }
+  if (m_simulationTimes[0] > 0) {
+    ImGui::Text("CPU %.3f ms, GPU %.3f ms", m_simulationTimes[0], m_simulationTimes[1]);
+  }
+  ImGui::Checkbox("Instanced fires", &m_multiFire);
+  if (m_multiFire) {
+    ImGui::SliderInt("Instances", &m_instanceCount, 1, MAX_INSTANCES);
+    const auto &stats = m_instanceRenderer->getStats();
+    ImGui::Text("%d draw call(s), %d upload(s) (%.1f KB) per frame", stats.drawCalls, stats.uploads,
+                static_cast<float>(stats.uploadBytes) / 1024.f);
+    const auto &instanceBuffer = m_instanceRenderer->getInstanceBuffer();
+    ImGui::Text("instance ring: %s, %d stall(s), %d orphan(s)", instanceBuffer.isPersistent() ? "persistent" : "orphaning",
+                instanceBuffer.getStats().stalls, instanceBuffer.getStats().orphans);
+  }
+  if (ImGui::Checkbox("Bloom", &m_bloomEnabled) && m_bloomEnabled) {
+    m_bloom->resetBudget();
+  }
+  if (m_bloomEnabled) {
+    auto budget = m_bloom->getBudget();
+    if (ImGui::SliderFloat("Bloom budget (ms)", &budget, 0.1f, 10.f)) {
+      m_bloom->setBudget(budget);
+      m_bloom->resetBudget();
+    }
+    auto threshold = m_bloom->getThreshold();
+    if (ImGui::SliderFloat("Bloom threshold", &threshold, 0.f, 1.f)) {
+      m_bloom->setThreshold(threshold);
+    }
+    auto intensity = m_bloom->getIntensity();
+    if (ImGui::SliderFloat("Bloom intensity", &intensity, 0.f, 4.f)) {
+      m_bloom->setIntensity(intensity);
     }
+    ImGui::Text("%d/%d bloom level(s) from 1/%d resolution, %.3f ms", m_bloom->getLevels(), Bloom::MaxLevels,
+                2 << m_bloom->getFirstLevel(), m_profiler->getAverage(m_bloomPhase));
+  }
+  if (ImGui::Checkbox("Dynamic resolution", &m_dynamicResolution) && !m_dynamicResolution) {
+    m_resolution.reset();
+    applyResolutionScale();
+  }
+  if (m_dynamicResolution) {
+    auto target = m_resolution.getTargetFrameTime();
+    if (ImGui::SliderFloat("Target (ms)", &target, 1.f, 33.f)) {
+      m_resolution.setTargetFrameTime(target);
+    }
+  }
+  ImGui::Text("Resolution %d%% (%dx%d), cost %.2f ms", static_cast<int>(std::lround(m_resolution.getScale() * 100)),
+              m_fire.getWidth(), m_fire.getHeight(), m_resolution.getFrameTime());
+  auto readback = m_readback != nullptr;
+  if (ImGui::Checkbox("Read back frames", &readback)) {
+    setReadback(readback);
   }
+  if (m_readback) {
+    const auto stats = m_readback->getStats();
+    ImGui::Text("%llu captured, %llu delivered, brightness %.3f", static_cast<unsigned long long>(stats.captured),
+                static_cast<unsigned long long>(stats.delivered), m_readbackBrightness.load());
+    ImGui::Text("dropped: %llu in flight, %llu unmapped, %llu by consumer",
+                static_cast<unsigned long long>(stats.droppedInFlight),
+                static_cast<unsigned long long>(stats.droppedUnmapped),
+                static_cast<unsigned long long>(stats.droppedByConsumer));
+    ImGui::Text("latency %.2f ms (%.1f frames)", stats.latency, stats.latencyFrames);
+  }
+  if (ImGui::Button(m_gifRecorder ? "Stop recording" : "Record GIF")) {
+    setGifRecording(!m_gifRecorder);
+  }
+  if (m_gifRecorder) {
+    const auto stats = m_gifRecorder->getStats();
+    ImGui::Text("%llu frame(s) written, %llu dropped, %.1f KB", static_cast<unsigned long long>(stats.written),
+                static_cast<unsigned long long>(stats.dropped), static_cast<float>(stats.bytes) / 1024.f);
+    if (m_backend != SimulationBackend::Cpu || m_multiFire) {
+      ImGui::Text("only the CPU simulation is recorded");
+    }
+  }
+  if (ImGui::Button(m_recording ? "Stop session" : "Record session")) {
+    setSessionRecording(!m_recording);
+  }
+  if (m_recording) {
+    const auto &stats = m_recording->getStats();
+    ImGui::Text("%llu frame(s), %.1f MB (%.1f:1), %.2f ms/frame", static_cast<unsigned long long>(stats.frames),
+                static_cast<float>(stats.bytes) / 1e6f,
+                static_cast<float>(stats.rawBytes) / static_cast<float>(std::max<std::uint64_t>(stats.bytes, 1)),
+                stats.encodeTime / static_cast<double>(std::max<std::uint64_t>(stats.frames, 1)));
+  }
+  if (m_player && ImGui::CollapsingHeader("Playback", ImGuiTreeNodeFlags_DefaultOpen)) {
+    renderPlayback();
+    if (m_backend != SimulationBackend::Cpu || m_multiFire) {
+      ImGui::Text("only the CPU simulation plays back");
+    }
+  }
+  if (m_streamer) {
+    const auto stats = m_streamer->getStats();
+    ImGui::Text("stream: %llu frame(s) written, %llu dropped, %.1f MB/s", static_cast<unsigned long long>(stats.written),
+                static_cast<unsigned long long>(stats.dropped), stats.throughput);
+  }
+  if (m_frameBus) {
+    const auto &stats = m_frameBus->getStats();
+    ImGui::Text("frame bus %s: %llu frame(s), %.3f ms/frame", m_frameBus->getName().c_str(),
+                static_cast<unsigned long long>(stats.published),
+                stats.publishTime / static_cast<double>(std::max<std::uint64_t>(stats.published, 1)));
+  }
+  auto lookup = static_cast<int>(m_lookup);
+  ImGui::RadioButton("Float lookup", &lookup, static_cast<int>(PaletteLookup::Float));
+  ImGui::SameLine();
+  ImGui::RadioButton("Integer lookup", &lookup, static_cast<int>(PaletteLookup::Integer));
+  if (m_backend == SimulationBackend::Cpu) {
+    m_lookup = static_cast<PaletteLookup>(lookup);
+  }
+  if (ImGui::Button("Benchmark lookup")) {
+    benchmarkLookup();
+  }
+  ImGui::Checkbox("Interpolate frames", &m_interpolate);
+  if (ImGui::Checkbox("Integer scaling", &m_integerScale)) {
+    reshape(m_windowWidth, m_windowHeight);
+  }
+  if (m_lookupTimes[0] > 0) {
+    ImGui::Text("float %.3f ms, integer %.3f ms", m_lookupTimes[0], m_lookupTimes[1]);
+  }
+  drawPalette(m_palette.data(), FirePalette::NumColors);
+  if (m_wadPalettes) {
+    auto palette = m_wadPalette;
+    auto lightLevel = m_wadLightLevel;
+    auto changed = ImGui::SliderInt("PLAYPAL", &palette, 0, m_wadPalettes->getPaletteCount() - 1);
+    if (m_wadPalettes->getLightLevelCount() > 0) {
+      changed |= ImGui::SliderInt("Light level", &lightLevel, 0, m_wadPalettes->getLightLevelCount() - 1);
+    }
+    // the outputs already open keep the palette they were opened with
+    if (changed && setWadPalette(palette, lightLevel)) {
+      m_pal_tex->setData(FirePalette::NumColors, 1, m_palette.data());
+    }
+  }
+  ImGui::End();
 }
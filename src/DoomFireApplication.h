@@ -1,35 +1,124 @@
 #pragma once
 #include <array>
+#include <atomic>
+#include <memory>
 #include "Application.h"
+#include "Bloom.h"
+#include "FireInstanceRenderer.h"
+#include "FireSimulation.h"
+#include "FrameReadback.h"
+#include "GifRecorder.h"
+#include "GpuFireSimulation.h"
+#include "GpuProfiler.h"
+#include "ResolutionController.h"
 #include "VertexArray.h"
 #include "VertexBuffer.h"
 #include "Texture.h"
 #include "Shader.h"
+#include "UniformBuffer.h"
 #include "RenderTarget.h"
 
+enum class PaletteLookup {
+  Float,
+  Integer,
+};
+
+enum class SimulationBackend {
+  Cpu,
+  Gpu,
+};
+
 class DoomFireApplication final : public Application {
+public:
+  using Application::Application;
+
 protected:
   void onInit() override;
   void onImGuiRender() override;
   void onEvent(SDL_Event &event) override;
   void onRender() override;
   void onUpdate(const TimeSpan &elapsed) override;
+  void onExit() override;
   void reset();
 
 private:
-  void reshape(int x, int y) const;
-  void spreadFire(int src);
-  void doFire();
+  void reshape(int x, int y);
+  void setBackend(SimulationBackend backend);
+  void renderInstances();
+  void renderImGui();
+  void createFireResources(int width, int height);
+  void applyResolutionScale();
+  [[nodiscard]] Shader *getShader(PaletteLookup lookup) const;
+  void bindIndexTextures(PaletteLookup lookup);
+  void uploadImage(PaletteLookup lookup);
+  void benchmarkLookup();
+  void benchmarkSimulation();
+  void setReadback(bool enabled);
+  void setGifRecording(bool enabled);
+  void setSessionRecording(bool enabled);
+  void renderPlayback();
 
 private:
   static constexpr int FIRE_WIDTH = 640;
   static constexpr int FIRE_HEIGHT = 480;
-  RenderTarget m_target{};
-  std::array<std::uint8_t, FIRE_WIDTH * FIRE_HEIGHT> m_image{};
+  static constexpr int INSTANCE_FIRE_WIDTH = 160;
+  static constexpr int INSTANCE_FIRE_HEIGHT = 120;
+  static constexpr int INSTANCE_LAYERS = 4;
+  static constexpr int MAX_INSTANCES = 64;
+  // the framebuffer of the window, or the offscreen one when headless
+  std::unique_ptr<RenderTarget> m_target{};
+  std::unique_ptr<RenderTarget> m_fireTarget{};
+  Viewport m_viewport{};
+  int m_windowWidth{0};
+  int m_windowHeight{0};
+  bool m_integerScale{true};
+  bool m_interpolate{true};
+  FireSimulation m_fire{FIRE_WIDTH, FIRE_HEIGHT};
+  std::unique_ptr<GpuFireSimulation> m_gpuFire{};
+  SimulationBackend m_backend{SimulationBackend::Cpu};
   std::unique_ptr<Shader> m_shader{};
+  std::unique_ptr<Shader> m_floatShader{};
   std::unique_ptr<VertexArray> m_vao{};
   std::unique_ptr<VertexBuffer> m_vbo{};
   std::unique_ptr<VertexBuffer> m_ebo{};
-  std::unique_ptr<Texture> m_img_tex{};
+  // index images of the latest and the previous simulation ticks, per palette lookup
+  std::array<std::unique_ptr<Texture>, 2> m_img_tex{};
+  std::array<std::unique_ptr<Texture>, 2> m_prev_img_tex{};
   std::unique_ptr<Texture> m_pal_tex{};
+  std::unique_ptr<UniformBuffer> m_frameUbo{};
+  PaletteLookup m_lookup{PaletteLookup::Integer};
+  std::array<float, 2> m_lookupTimes{};
+  std::array<float, 2> m_simulationTimes{};
+  // instanced mode: small fires packed in the layers of a texture array, drawn many times
+  std::unique_ptr<FireInstanceRenderer> m_instanceRenderer{};
+  std::vector<FireSimulation> m_instanceFires{};
+  std::vector<FireInstance> m_instances{};
+  int m_instanceCount{16};
+  bool m_multiFire{false};
+  // GPU time of the phases of the frame, shown as graphs in the Info window
+  std::unique_ptr<GpuProfiler> m_profiler{};
+  GpuProfiler::Phase m_simulationPhase{};
+  GpuProfiler::Phase m_uploadPhase{};
+  GpuProfiler::Phase m_drawPhase{};
+  GpuProfiler::Phase m_imguiPhase{};
+  GpuProfiler::Phase m_bloomPhase{};
+  // optional glow, its number of levels follows the GPU time of the bloom phase
+  std::unique_ptr<Bloom> m_bloom{};
+  bool m_bloomEnabled{false};
+  std::size_t m_profilerSamples{0};
+  // the fire and its render target shrink when the frames cost more than the target
+  ResolutionController m_resolution{12.f};
+  bool m_dynamicResolution{false};
+  float m_simulationTime{0};
+  int m_simulationFrames{0};
+  // frames read back for monitoring, the consumer measures their brightness on the readback thread: declared
+  // after what the consumer writes, the thread is joined before it is destroyed
+  std::atomic<float> m_readbackBrightness{0};
+  std::unique_ptr<FrameReadback> m_readback{};
+  // the indices of the CPU fire are recorded every few ticks, encoded on the recorder threads
+  std::unique_ptr<GifRecorder> m_gifRecorder{};
+  int m_recordTicks{0};
+  // playback of a session recording, it replaces the CPU simulation
+  bool m_playbackPaused{false};
+  int m_playbackSpeed{1};
 };
@@ -0,0 +1,106 @@
+#include "FireInstanceRenderer.h"
+#include <cstddef>
+#include <glm/vec2.hpp>
+
+static const char *vertexShaderSource =
+    R"(#version 330 core
+layout (location = 0) in vec2 attr_vertex;
+layout (location = 1) in vec4 attr_rect;
+layout (location = 2) in float attr_layer;
+out vec2 uv;
+flat out int layer;
+void main()
+{
+   vec2 corner = attr_vertex * 0.5 + 0.5;
+   gl_Position = vec4(attr_rect.xy + corner * attr_rect.zw, 0.0, 1.0);
+   uv = vec2(corner.x, 1.0 - corner.y);
+   layer = int(attr_layer);
+})";
+
+static const char *fragmentShaderSource =
+    R"(#version 330 core
+out vec4 FragColor;
+in vec2 uv;
+flat in int layer;
+uniform usampler2DArray img_tex;
+uniform sampler1D pal_tex;
+void main()
+{
+  ivec2 size = textureSize(img_tex, 0).xy;
+  ivec2 texel = min(ivec2(uv * vec2(size)), size - 1);
+  uint cidx = texelFetch(img_tex, ivec3(texel, layer), 0).x;
+  FragColor.xyz = texelFetch(pal_tex, int(cidx), 0).xyz;
+  FragColor.a = 1.0;
+})";
+
+namespace {
+constexpr glm::vec2 vertices[] = {
+    {1.0f, 1.0f},
+    {1.0f, -1.0f},
+    {-1.0f, -1.0f},
+    {-1.0f, 1.0f},
+};
+
+constexpr unsigned int indices[] = {
+    0, 1, 3,
+    1, 2, 3
+};
+
+constexpr unsigned int VertexBinding = 0;
+constexpr unsigned int InstanceBinding = 1;
+}// namespace
+
+FireInstanceRenderer::FireInstanceRenderer(int width, int height, int layers, int maxInstances, const Texture &palette)
+    : m_width(width), m_height(height), m_layers(layers) {
+  m_images = std::make_unique<Texture>(Texture::Format::Index, width, height, layers);
+  m_shader = std::make_unique<Shader>(vertexShaderSource, fragmentShaderSource);
+  m_shader->setUniform(m_shader->getUniformHandle("img_tex"), *m_images);
+  m_shader->setUniform(m_shader->getUniformHandle("pal_tex"), palette);
+
+  m_vbo = std::make_unique<VertexBuffer>(VertexBuffer::Type::Array);
+  m_ebo = std::make_unique<VertexBuffer>(VertexBuffer::Type::Element);
+  m_instances = std::make_unique<StreamingVertexBuffer>(VertexBuffer::Type::Array, maxInstances * sizeof(FireInstance));
+  m_vao = std::make_unique<VertexArray>();
+
+  m_vbo->buffer(sizeof(vertices), vertices);
+  m_ebo->buffer(sizeof(indices), indices);
+  m_vao->setVertexBuffer(VertexBinding, *m_vbo, 0, sizeof(glm::vec2));
+  m_vao->setVertexBuffer(InstanceBinding, m_instances->getBuffer(), 0, sizeof(FireInstance));
+  m_vao->setBindingDivisor(InstanceBinding, 1);
+  m_vao->setElementBuffer(*m_ebo);
+  m_vao->setAttribute(0, VertexBinding, 2, GL_FLOAT, false, 0);
+  m_vao->setAttribute(1, InstanceBinding, 4, GL_FLOAT, false, offsetof(FireInstance, rect));
+  m_vao->setAttribute(2, InstanceBinding, 1, GL_FLOAT, false, offsetof(FireInstance, layer));
+
+  m_images->setLabel("instance fire images");
+  m_shader->setLabel("instanced fire");
+  m_vbo->setLabel("instance quad vertices");
+  m_ebo->setLabel("instance quad indices");
+  m_instances->getBuffer().setLabel("instance ring");
+  m_vao->setLabel("instanced fire");
+}
+
+void FireInstanceRenderer::setLayer(int layer, const std::uint8_t *image) {
+  assert(layer >= 0 && layer < m_layers);
+  m_images->setLayer(layer, m_width, m_height, image);
+  m_stats.uploads++;
+  m_stats.uploadBytes += static_cast<std::size_t>(m_width) * m_height;
+}
+
+void FireInstanceRenderer::setInstances(const std::vector<FireInstance> &instances) {
+  auto size = instances.size() * sizeof(FireInstance);
+  auto offset = m_instances->write(instances.data(), size, sizeof(float));
+  m_vao->setVertexBuffer(InstanceBinding, m_instances->getBuffer(), offset, sizeof(FireInstance));
+  m_instanceCount = instances.size();
+  m_stats.uploads++;
+  m_stats.uploadBytes += size;
+}
+
+void FireInstanceRenderer::draw(RenderTarget &target) {
+  if (m_instanceCount == 0)
+    return;
+  m_vao->bind();
+  target.drawInstanced(PrimitiveType::Triangles, ElementType::UnsignedInt, 6, m_instanceCount, m_shader.get());
+  VertexArray::unbind();
+  m_stats.drawCalls++;
+}
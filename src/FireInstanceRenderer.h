@@ -0,0 +1,69 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <glm/vec4.hpp>
+#include "RenderTarget.h"
+#include "Shader.h"
+#include "StreamingVertexBuffer.h"
+#include "Texture.h"
+#include "VertexArray.h"
+#include "VertexBuffer.h"
+
+/// A fire drawn by FireInstanceRenderer.
+struct FireInstance {
+  /// Left, bottom, width and height of the fire in normalized device coordinates.
+  glm::vec4 rect;
+  /// Layer of the texture array holding the fire image.
+  float layer;
+};
+
+/// Draws many fires in a single instanced call: the fire images are packed in the layers of
+/// a GL_TEXTURE_2D_ARRAY and the instance rectangles are streamed to one vertex buffer.
+class FireInstanceRenderer {
+public:
+  struct Stats {
+    int drawCalls{0};
+    int uploads{0};
+    std::size_t uploadBytes{0};
+  };
+
+  /// \param width: Specifies the width of each fire image.
+  /// \param height: Specifies the height of each fire image.
+  /// \param layers: Specifies the number of fire images.
+  /// \param palette: Specifies the palette texture indexed by the fire images.
+  /// \param maxInstances: Specifies the maximum number of instances drawn per frame.
+  FireInstanceRenderer(int width, int height, int layers, int maxInstances, const Texture &palette);
+
+  /// Replaces the image of a layer.
+  void setLayer(int layer, const std::uint8_t *image);
+  /// Replaces the instances to draw.
+  void setInstances(const std::vector<FireInstance> &instances);
+  /// Draws all the instances with one draw call.
+  void draw(RenderTarget &target);
+
+  /// Returns the counters accumulated since the last call to endFrame.
+  [[nodiscard]] const Stats &getStats() const noexcept { return m_stats; }
+  [[nodiscard]] const StreamingVertexBuffer &getInstanceBuffer() const noexcept { return *m_instances; }
+  void endFrame() {
+    m_instances->endFrame();
+    m_stats = {};
+  }
+
+  [[nodiscard]] int getWidth() const noexcept { return m_width; }
+  [[nodiscard]] int getHeight() const noexcept { return m_height; }
+  [[nodiscard]] int getLayers() const noexcept { return m_layers; }
+
+private:
+  int m_width;
+  int m_height;
+  int m_layers;
+  std::size_t m_instanceCount{0};
+  Stats m_stats{};
+  std::unique_ptr<Texture> m_images{};
+  std::unique_ptr<Shader> m_shader{};
+  std::unique_ptr<VertexBuffer> m_vbo{};
+  std::unique_ptr<VertexBuffer> m_ebo{};
+  std::unique_ptr<StreamingVertexBuffer> m_instances{};
+  std::unique_ptr<VertexArray> m_vao{};
+};
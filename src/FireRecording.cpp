@@ -0,0 +1,278 @@
+#include "FireRecording.h"
+#include "Util.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+constexpr char FileMagic[4]{'D', 'F', 'R', 'C'};
+constexpr char IndexMagic[4]{'D', 'F', 'I', 'X'};
+constexpr std::size_t HeaderSize = 4 + 2 * 6;
+constexpr std::size_t FrameHeaderSize = 1 + 4;
+// offset of the index, number of frames, magic
+constexpr std::size_t TrailerSize = 8 + 4 + 4;
+constexpr std::uint8_t KeyFrame = 0;
+constexpr std::uint8_t DeltaFrame = 1;
+// the shortest repeat worth a control byte, and the longest ones
+constexpr std::size_t MinRun = 3;
+constexpr std::size_t MaxRun = 130;
+constexpr std::size_t MaxLiteral = 128;
+
+void writeValue(std::vector<std::uint8_t> &out, std::uint64_t value, int size) {
+  for (auto i = 0; i < size; ++i) {
+    out.push_back(static_cast<std::uint8_t>(value >> (i * 8)));
+  }
+}
+
+std::uint64_t readValue(const std::uint8_t *data, int size) {
+  std::uint64_t value = 0;
+  for (auto i = 0; i < size; ++i) {
+    value |= static_cast<std::uint64_t>(data[i]) << (i * 8);
+  }
+  return value;
+}
+
+std::size_t runLength(const std::uint8_t *data, std::size_t i, std::size_t size) {
+  const auto end = std::min(size, i + MaxRun);
+  auto j = i + 1;
+  while (j < end && data[j] == data[i]) {
+    ++j;
+  }
+  return j - i;
+}
+
+void compress(const std::uint8_t *data, std::size_t size, std::vector<std::uint8_t> &out) {
+  std::size_t i = 0;
+  while (i < size) {
+    const auto run = runLength(data, i, size);
+    if (run >= MinRun) {
+      out.push_back(static_cast<std::uint8_t>(run + 125));
+      out.push_back(data[i]);
+      i += run;
+      continue;
+    }
+    // the literals stop where a run starts
+    const auto start = i;
+    while (i < size && i - start < MaxLiteral
+           && !(i + MinRun <= size && data[i] == data[i + 1] && data[i] == data[i + 2])) {
+      ++i;
+    }
+    out.push_back(static_cast<std::uint8_t>(i - start - 1));
+    out.insert(out.end(), data + start, data + i);
+  }
+}
+
+/// Decodes a payload over the image, replacing its bytes or XORing them: the runs of zeros of a delta are skipped.
+template<bool Xor>
+bool decompress(const std::uint8_t *data, std::size_t size, std::uint8_t *image, std::size_t imageSize) {
+  std::size_t out = 0;
+  const auto end = data + size;
+  while (data < end) {
+    const auto control = *data++;
+    if (control < 128) {
+      const std::size_t count = control + 1u;
+      if (static_cast<std::size_t>(end - data) < count || imageSize - out < count)
+        return false;
+      for (std::size_t i = 0; i < count; ++i) {
+        image[out + i] = Xor ? image[out + i] ^ data[i] : data[i];
+      }
+      data += count;
+      out += count;
+    } else {
+      const std::size_t count = control - 125u;
+      if (data == end || imageSize - out < count)
+        return false;
+      const auto value = *data++;
+      if (!Xor) {
+        std::memset(image + out, value, count);
+      } else if (value != 0) {
+        for (std::size_t i = 0; i < count; ++i) {
+          image[out + i] ^= value;
+        }
+      }
+      out += count;
+    }
+  }
+  return out == imageSize;
+}
+
+[[noreturn]] void throwInvalid(const std::string &path, const char *reason) {
+  std::ostringstream ss;
+  ss << "Invalid recording " << path << ": " << reason;
+  throw std::runtime_error(ss.str());
+}
+}// namespace
+
+FireRecordingWriter::FireRecordingWriter(const std::string &path, int width, int height, const std::uint8_t *palette,
+                                         int numColors, int fps, int keyframeInterval)
+    : m_path(path), m_width(width), m_height(height), m_keyframeInterval(std::max(keyframeInterval, 1)),
+      m_image(static_cast<std::size_t>(width) * height), m_previous(m_image.size()) {
+  m_file.open(path, std::ios::binary | std::ios::trunc);
+  if (!m_file) {
+    std::ostringstream ss;
+    ss << "Unable to create the recording " << path;
+    throw std::runtime_error(ss.str());
+  }
+
+  numColors = std::clamp(numColors, 0, 256);
+  std::vector<std::uint8_t> header(std::begin(FileMagic), std::end(FileMagic));
+  for (auto value : {static_cast<int>(FireRecording::Version), width, height, fps, m_keyframeInterval, numColors}) {
+    writeValue(header, static_cast<std::uint64_t>(value), 2);
+  }
+  header.insert(header.end(), palette, palette + numColors * 3);
+  m_file.write(reinterpret_cast<const char *>(header.data()), static_cast<std::streamsize>(header.size()));
+  m_stats.bytes = header.size();
+}
+
+FireRecordingWriter::~FireRecordingWriter() {
+  std::vector<std::uint8_t> index;
+  index.reserve(m_offsets.size() * 8 + TrailerSize);
+  for (auto offset : m_offsets) {
+    writeValue(index, offset, 8);
+  }
+  writeValue(index, m_stats.bytes, 8);
+  writeValue(index, m_offsets.size(), 4);
+  index.insert(index.end(), std::begin(IndexMagic), std::end(IndexMagic));
+  m_file.write(reinterpret_cast<const char *>(index.data()), static_cast<std::streamsize>(index.size()));
+}
+
+void FireRecordingWriter::addFrame(const std::uint8_t *indices, int width, int height) {
+  const auto start = std::chrono::steady_clock::now();
+  // the fire changes resolution, the recording keeps its size
+  Util::resample(indices, width, height, m_image.data(), m_width, m_height);
+
+  const auto keyframe = m_stats.frames % static_cast<std::uint64_t>(m_keyframeInterval) == 0;
+  m_payload.clear();
+  // room for the frame header, written once the payload size is known
+  m_payload.resize(FrameHeaderSize);
+  if (keyframe) {
+    compress(m_image.data(), m_image.size(), m_payload);
+  } else {
+    // the previous image becomes the delta, it is replaced by the current one below
+    for (std::size_t i = 0; i < m_image.size(); ++i) {
+      m_previous[i] ^= m_image[i];
+    }
+    compress(m_previous.data(), m_previous.size(), m_payload);
+  }
+  std::swap(m_previous, m_image);
+
+  m_payload[0] = keyframe ? KeyFrame : DeltaFrame;
+  const auto payloadSize = m_payload.size() - FrameHeaderSize;
+  for (auto i = 0; i < 4; ++i) {
+    m_payload[1 + i] = static_cast<std::uint8_t>(payloadSize >> (i * 8));
+  }
+  m_file.write(reinterpret_cast<const char *>(m_payload.data()), static_cast<std::streamsize>(m_payload.size()));
+
+  m_offsets.push_back(m_stats.bytes);
+  m_stats.frames++;
+  m_stats.keyframes += keyframe ? 1 : 0;
+  m_stats.bytes += m_payload.size();
+  m_stats.rawBytes += m_image.size();
+  m_stats.encodeTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+FireRecordingPlayer::FireRecordingPlayer(const std::string &path) : m_path(path), m_file(path) {
+  const auto data = m_file.data();
+  const auto size = m_file.size();
+  if (size < HeaderSize || std::memcmp(data, FileMagic, sizeof(FileMagic)) != 0)
+    throwInvalid(path, "not a recording");
+  if (readValue(data + 4, 2) != FireRecording::Version)
+    throwInvalid(path, "unsupported version");
+  m_width = static_cast<int>(readValue(data + 6, 2));
+  m_height = static_cast<int>(readValue(data + 8, 2));
+  m_fps = static_cast<int>(readValue(data + 10, 2));
+  m_keyframeInterval = std::max(static_cast<int>(readValue(data + 12, 2)), 1);
+  m_numColors = static_cast<int>(readValue(data + 14, 2));
+  const auto framesStart = HeaderSize + static_cast<std::size_t>(m_numColors) * 3;
+  if (m_width == 0 || m_height == 0 || m_numColors > 256 || size < framesStart)
+    throwInvalid(path, "corrupted header");
+  m_palette = data + HeaderSize;
+  m_image.resize(static_cast<std::size_t>(m_width) * m_height);
+
+  auto hasIndex = false;
+  if (size >= framesStart + TrailerSize
+      && std::memcmp(data + size - sizeof(IndexMagic), IndexMagic, sizeof(IndexMagic)) == 0) {
+    const auto indexOffset = readValue(data + size - TrailerSize, 8);
+    const auto count = readValue(data + size - TrailerSize + 8, 4);
+    // bounded before multiplying, a corrupted trailer must not wrap around to a size that matches
+    hasIndex = indexOffset >= framesStart && indexOffset <= size - TrailerSize
+               && count == (size - TrailerSize - indexOffset) / 8 && indexOffset + count * 8 + TrailerSize == size;
+    if (hasIndex) {
+      m_offsets.resize(count);
+      for (std::size_t i = 0; i < count; ++i) {
+        m_offsets[i] = readValue(data + indexOffset + i * 8, 8);
+      }
+    }
+  }
+  if (!hasIndex) {
+    scanFrames(framesStart);
+  }
+  if (m_offsets.empty())
+    throwInvalid(path, "no frame");
+
+  // the seeks jump around the file, read-ahead would load pages that are not needed
+  m_file.advise(MappedFile::Access::Random);
+}
+
+void FireRecordingPlayer::scanFrames(std::size_t start) {
+  const auto size = m_file.size();
+  auto offset = start;
+  // the last frame may have been cut short, the index may follow the frames without its trailer
+  while (size - offset >= FrameHeaderSize) {
+    const auto type = m_file.data()[offset];
+    const auto keyframe = m_offsets.size() % static_cast<std::size_t>(m_keyframeInterval) == 0;
+    if (type != (keyframe ? KeyFrame : DeltaFrame))
+      break;
+    const auto payloadSize = readValue(m_file.data() + offset + 1, 4);
+    if (payloadSize > size - offset - FrameHeaderSize)
+      break;
+    m_offsets.push_back(offset);
+    offset += FrameHeaderSize + payloadSize;
+  }
+}
+
+void FireRecordingPlayer::seek(int frame) {
+  const auto count = getFrameCount();
+  frame = ((frame % count) + count) % count;
+  m_decodedFrames = 0;
+  if (frame == m_frame)
+    return;
+
+  // from the current frame when it is on the way, from the keyframe before the target otherwise
+  const auto keyframe = frame - frame % m_keyframeInterval;
+  auto first = keyframe;
+  if (m_frame >= keyframe && m_frame < frame) {
+    first = m_frame + 1;
+  }
+  // a corrupted frame leaves the image undefined
+  m_frame = -1;
+  for (auto i = first; i <= frame; ++i) {
+    decode(i);
+    m_decodedFrames++;
+  }
+  m_frame = frame;
+}
+
+void FireRecordingPlayer::decode(int frame) {
+  const auto offset = m_offsets[static_cast<std::size_t>(frame)];
+  const auto size = m_file.size();
+  if (offset > size || size - offset < FrameHeaderSize)
+    throwInvalid(m_path, "frame out of the file");
+  const auto data = m_file.data() + offset;
+  const auto payloadSize = readValue(data + 1, 4);
+  if (payloadSize > size - offset - FrameHeaderSize)
+    throwInvalid(m_path, "frame out of the file");
+
+  const auto type = data[0];
+  // a delta needs the frame before it, the keyframes must be where the interval says
+  if ((type == KeyFrame) != (frame % m_keyframeInterval == 0))
+    throwInvalid(m_path, "unexpected frame type");
+  const auto payload = data + FrameHeaderSize;
+  const auto valid = type == KeyFrame
+                         ? decompress<false>(payload, payloadSize, m_image.data(), m_image.size())
+                         : decompress<true>(payload, payloadSize, m_image.data(), m_image.size());
+  if (!valid)
+    throwInvalid(m_path, "corrupted frame");
+}
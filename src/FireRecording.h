@@ -0,0 +1,126 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+
+/// Session recordings: sequences of fire images stored as keyframes and deltas.
+///
+/// Layout, little-endian:
+/// - header: "DFRC", version (u16), width, height, frame rate, keyframe interval and number of colors (u16 each),
+///   then the palette as RGB triplets;
+/// - frames: type (u8, 0 for a keyframe, 1 for a delta), payload size (u32), payload. The payload is the image,
+///   or its XOR with the previous one, compressed with a run-length code: a control byte c < 128 is followed by
+///   c + 1 literal bytes, c >= 128 by one byte repeated c - 125 times;
+/// - index: the offset of each frame (u64), then the offset of the index (u64), the number of frames (u32) and "DFIX".
+///
+/// A keyframe starts every interval, so any frame is decoded from at most one keyframe and interval - 1 deltas.
+/// The flames move little from one tick to the next and their upper part is black: deltas are mostly zero runs.
+namespace FireRecording {
+constexpr std::uint16_t Version = 1;
+/// Number of frames from one keyframe to the next.
+constexpr int DefaultKeyframeInterval = 60;
+}// namespace FireRecording
+
+/// Writes a recording, one frame per simulation tick.
+class FireRecordingWriter {
+public:
+  struct Stats {
+    std::uint64_t frames{0};
+    std::uint64_t keyframes{0};
+    /// Size of the file so far.
+    std::uint64_t bytes{0};
+    /// Size the frames would take uncompressed.
+    std::uint64_t rawBytes{0};
+    /// Time spent compressing and writing, in milliseconds.
+    double encodeTime{0};
+  };
+
+  /// \param path: Specifies the file to write.
+  /// \param width: Specifies the width of the recording, frames of another size are resampled.
+  /// \param height: Specifies the height of the recording.
+  /// \param palette: Specifies the colors as RGB triplets.
+  /// \param numColors: Specifies the number of colors of the palette, at most 256.
+  /// \param fps: Specifies the frame rate of the playback.
+  /// \param keyframeInterval: Specifies the number of frames from one keyframe to the next.
+  FireRecordingWriter(const std::string &path, int width, int height, const std::uint8_t *palette, int numColors,
+                      int fps, int keyframeInterval = FireRecording::DefaultKeyframeInterval);
+  /// Writes the index, the recording is not seekable without it.
+  ~FireRecordingWriter();
+
+  FireRecordingWriter(const FireRecordingWriter &) = delete;
+  FireRecordingWriter &operator=(const FireRecordingWriter &) = delete;
+
+  /// Compresses and appends a frame.
+  /// \param indices: Specifies the palette indices, width * height bytes, rows from top to bottom.
+  void addFrame(const std::uint8_t *indices, int width, int height);
+
+  [[nodiscard]] const Stats &getStats() const noexcept { return m_stats; }
+  [[nodiscard]] const std::string &getPath() const noexcept { return m_path; }
+
+private:
+  std::string m_path;
+  std::ofstream m_file;
+  int m_width;
+  int m_height;
+  int m_keyframeInterval;
+  std::vector<std::uint8_t> m_image;
+  std::vector<std::uint8_t> m_previous;
+  std::vector<std::uint8_t> m_payload;
+  std::vector<std::uint64_t> m_offsets;
+  Stats m_stats;
+};
+
+/// Plays a recording from a memory-mapped file.
+///
+/// Seeking looks the frame up in the index and decodes from the keyframe before it, or from the current frame
+/// when it is ahead in the same interval: scrubbing and fast-forward never decode from the start. Recordings
+/// whose writer did not finish have no index, their frames are found by walking the file once when opening it.
+class FireRecordingPlayer {
+public:
+  /// \param path: Specifies the recording, an exception is thrown when it cannot be read.
+  explicit FireRecordingPlayer(const std::string &path);
+
+  /// Decodes a frame into the image.
+  /// \param frame: Specifies the frame, it wraps around the number of frames.
+  void seek(int frame);
+  /// Decodes the next frame, the playback loops.
+  void next() { seek(m_frame + 1); }
+
+  [[nodiscard]] int getWidth() const noexcept { return m_width; }
+  [[nodiscard]] int getHeight() const noexcept { return m_height; }
+  [[nodiscard]] int getFps() const noexcept { return m_fps; }
+  [[nodiscard]] int getKeyframeInterval() const noexcept { return m_keyframeInterval; }
+  [[nodiscard]] int getFrameCount() const noexcept { return static_cast<int>(m_offsets.size()); }
+  /// Returns the frame in the image, -1 before the first seek.
+  [[nodiscard]] int getFrame() const noexcept { return m_frame; }
+  /// Returns the number of frames the last seek has decoded, keyframe included.
+  [[nodiscard]] int getDecodedFrames() const noexcept { return m_decodedFrames; }
+  [[nodiscard]] const std::uint8_t *getImage() const noexcept { return m_image.data(); }
+  [[nodiscard]] const std::uint8_t *getPalette() const noexcept { return m_palette; }
+  [[nodiscard]] int getNumColors() const noexcept { return m_numColors; }
+  [[nodiscard]] std::size_t getFileSize() const noexcept { return m_file.size(); }
+
+private:
+  // decodes a frame over the image: a keyframe replaces it, a delta is XORed with it
+  void decode(int frame);
+  // rebuilds the index of a recording without one
+  void scanFrames(std::size_t start);
+
+private:
+  std::string m_path;
+  MappedFile m_file;
+  int m_width{0};
+  int m_height{0};
+  int m_fps{0};
+  int m_keyframeInterval{1};
+  int m_numColors{0};
+  const std::uint8_t *m_palette{nullptr};
+  std::vector<std::uint64_t> m_offsets;
+  std::vector<std::uint8_t> m_image;
+  int m_frame{-1};
+  int m_decodedFrames{0};
+};
@@ -0,0 +1,69 @@
+#include "FireSimulation.h"
+#include "Util.h"
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+FireSimulation::FireSimulation(int width, int height, std::uint32_t seed)
+    : m_width(width), m_height(height), m_random(seed != 0 ? seed : DefaultSeed),
+      m_image(static_cast<std::size_t>(width) * height) {
+  reset();
+}
+
+void FireSimulation::reset() {
+  // Set whole screen to 0 (color: 0x07,0x07,0x07)
+  memset(m_image.data(), 0, m_image.size());
+
+  // Set bottom line to 37 (color white: 0xFF,0xFF,0xFF)
+  memset(m_image.data() + (m_height - 1) * m_width, MaxIntensity, m_width);
+  m_tick = 0;
+}
+
+void FireSimulation::update() {
+  for (auto x = 0; x < m_width; x++) {
+    for (auto y = 1; y < m_height; y++) {
+      spreadFire(y * m_width + x);
+    }
+  }
+  m_tick++;
+}
+
+void FireSimulation::resize(int width, int height) {
+  if (width == m_width && height == m_height)
+    return;
+
+  std::vector<std::uint8_t> image(static_cast<std::size_t>(width) * height);
+  Util::resample(m_image.data(), m_width, m_height, image.data(), width, height);
+  // the source of the fire must stay lit whatever row was sampled
+  memset(image.data() + static_cast<std::size_t>(height - 1) * width, MaxIntensity, width);
+
+  m_image = std::move(image);
+  m_width = width;
+  m_height = height;
+}
+
+void FireSimulation::setImage(const std::uint8_t *image, int width, int height) {
+  Util::resample(image, width, height, m_image.data(), m_width, m_height);
+}
+
+void FireSimulation::restore(const std::uint8_t *image, int width, int height, std::uint32_t tick,
+                             std::uint32_t randomState) {
+  m_width = width;
+  m_height = height;
+  m_image.assign(image, image + static_cast<std::size_t>(width) * height);
+  m_tick = tick;
+  m_random = randomState != 0 ? randomState : DefaultSeed;
+}
+
+void FireSimulation::spreadFire(int src) {
+  auto pixel = m_image[src];
+  if (pixel == 0) {
+    m_image[src - m_width] = 0;
+  } else {
+    // 0, 1 or 2 from the high bits, the low ones of xorshift are the weakest
+    auto randIdx = static_cast<int>((static_cast<std::uint64_t>(nextRandom()) * 3) >> 32);
+    // the first pixel of the second row cannot spread further left than the image start
+    auto dst = std::max(src - randIdx + 1, m_width);
+    m_image[dst - m_width] = pixel - (randIdx & 1);
+  }
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+/// CPU implementation of the PSX Doom fire: an image of palette indices where each pixel
+/// spreads a randomly decayed copy of itself to the row above.
+class FireSimulation {
+public:
+  static constexpr std::uint8_t MaxIntensity = 36;
+  static constexpr std::uint32_t DefaultSeed = 0x9E3779B9u;
+
+  /// \param seed: Specifies the seed of the random generator, simulations with the same seed tick identically.
+  FireSimulation(int width, int height, std::uint32_t seed = DefaultSeed);
+
+  /// Clears the image and lights the bottom row.
+  void reset();
+  /// Advances the fire by one tick.
+  void update();
+  /// Changes the size of the image, the current flames are resampled so the fire does not restart.
+  void resize(int width, int height);
+  /// Replaces the image, to play back a recording: an image of another size is resampled, the bottom row is kept as it is.
+  /// \param image: Specifies the palette indices, width * height bytes, rows from top to bottom.
+  void setImage(const std::uint8_t *image, int width, int height);
+  /// Restores a saved state: the next ticks are the ones the saved simulation would have run.
+  /// \param image: Specifies the palette indices, width * height bytes, rows from top to bottom.
+  /// \param tick: Specifies the tick counter.
+  /// \param randomState: Specifies the state of the random generator, as returned by getRandomState().
+  void restore(const std::uint8_t *image, int width, int height, std::uint32_t tick, std::uint32_t randomState);
+
+  [[nodiscard]] int getWidth() const noexcept { return m_width; }
+  [[nodiscard]] int getHeight() const noexcept { return m_height; }
+  [[nodiscard]] std::uint32_t getTick() const noexcept { return m_tick; }
+  [[nodiscard]] std::uint32_t getRandomState() const noexcept { return m_random; }
+  [[nodiscard]] const std::uint8_t *getImage() const noexcept { return m_image.data(); }
+  [[nodiscard]] std::uint8_t *getImage() noexcept { return m_image.data(); }
+
+private:
+  void spreadFire(int src);
+  // xorshift32: owned by the simulation so that its state can be saved, and cheaper than rand()
+  std::uint32_t nextRandom() noexcept {
+    m_random ^= m_random << 13;
+    m_random ^= m_random >> 17;
+    m_random ^= m_random << 5;
+    return m_random;
+  }
+
+private:
+  int m_width;
+  int m_height;
+  std::uint32_t m_tick{0};
+  // never zero, xorshift would stay there
+  std::uint32_t m_random;
+  std::vector<std::uint8_t> m_image;
+};
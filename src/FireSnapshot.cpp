@@ -0,0 +1,77 @@
+#include "FireSnapshot.h"
+#include "FireSimulation.h"
+#include "MappedFile.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+constexpr char Magic[4]{'D', 'F', 'S', 'S'};
+constexpr std::uint32_t ByteOrderMark = 0x01020304u;
+
+[[noreturn]] void throwInvalid(const std::string &path, const char *reason) {
+  std::ostringstream ss;
+  ss << "Invalid snapshot " << path << ": " << reason;
+  throw std::runtime_error(ss.str());
+}
+}// namespace
+
+namespace FireSnapshot {
+void save(const FireSimulation &fire, const std::string &path) {
+  Header header{};
+  std::memcpy(header.magic, Magic, sizeof(Magic));
+  header.version = Version;
+  header.byteOrder = ByteOrderMark;
+  header.width = static_cast<std::uint32_t>(fire.getWidth());
+  header.height = static_cast<std::uint32_t>(fire.getHeight());
+  header.tick = fire.getTick();
+  header.randomState = fire.getRandomState();
+  header.imageOffset = sizeof(Header);
+
+  const auto tempPath = path + ".tmp";
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(fire.getImage()),
+               static_cast<std::streamsize>(header.width) * static_cast<std::streamsize>(header.height));
+    if (!file) {
+      std::ostringstream ss;
+      ss << "Unable to write the snapshot " << tempPath;
+      throw std::runtime_error(ss.str());
+    }
+  }
+  // on POSIX the rename replaces an existing snapshot atomically, Windows refuses to replace it
+#ifdef _WIN32
+  std::remove(path.c_str());
+#endif
+  if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+    std::ostringstream ss;
+    ss << "Unable to rename " << tempPath << " to " << path;
+    throw std::runtime_error(ss.str());
+  }
+}
+
+void load(FireSimulation &fire, const std::string &path) {
+  MappedFile file(path);
+  Header header{};
+  if (file.size() < sizeof(Header))
+    throwInvalid(path, "too small");
+  // the mapping is page aligned, the copy keeps this independent of it
+  std::memcpy(&header, file.data(), sizeof(Header));
+  if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0)
+    throwInvalid(path, "not a snapshot");
+  if (header.byteOrder != ByteOrderMark)
+    throwInvalid(path, "written on a machine of another byte order");
+  if (header.version != Version)
+    throwInvalid(path, "unsupported version");
+  const auto imageSize = static_cast<std::size_t>(header.width) * header.height;
+  if (header.width == 0 || header.height == 0 || header.imageOffset < sizeof(Header)
+      || header.imageOffset > file.size() || file.size() - header.imageOffset < imageSize)
+    throwInvalid(path, "corrupted header");
+
+  fire.restore(file.data() + header.imageOffset, static_cast<int>(header.width), static_cast<int>(header.height),
+               header.tick, header.randomState);
+}
+}// namespace FireSnapshot
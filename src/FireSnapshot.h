@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+class FireSimulation;
+
+/// Complete states of a FireSimulation saved to files, to start from a developed fire or to reproduce a state exactly.
+///
+/// The file is a fixed header followed by the image, in the byte order of the machine that wrote it: loading maps
+/// the file and copies the image into the simulation, there is nothing to parse. Restoring a snapshot then running
+/// N ticks gives the same images as the simulation that saved it.
+namespace FireSnapshot {
+constexpr std::uint32_t Version = 1;
+
+/// Layout of the start of the file.
+struct Header {
+  char magic[4];
+  std::uint32_t version;
+  /// Reads as 0x01020304 on a machine of the same byte order.
+  std::uint32_t byteOrder;
+  std::uint32_t width;
+  std::uint32_t height;
+  std::uint32_t tick;
+  std::uint32_t randomState;
+  /// Position of the image in the file, later versions can extend the header.
+  std::uint32_t imageOffset;
+};
+static_assert(sizeof(Header) == 32, "the header is written as it is");
+
+/// Writes the state of a simulation, through a temporary file renamed at the end so a crash never leaves half a snapshot.
+/// \param fire: Specifies the simulation to save.
+/// \param path: Specifies the file to write, an exception is thrown when it cannot be written.
+void save(const FireSimulation &fire, const std::string &path);
+
+/// Restores the state of a simulation, its size becomes the size of the snapshot.
+/// \param fire: Specifies the simulation to restore.
+/// \param path: Specifies the file to read, an exception is thrown when it is not a valid snapshot.
+void load(FireSimulation &fire, const std::string &path);
+}// namespace FireSnapshot
@@ -0,0 +1,264 @@
+#include "FrameBus.h"
+#include "Util.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#if defined(__unix__) || defined(__APPLE__)
+#define FRAME_BUS_POSIX
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+namespace {
+constexpr char Magic[8]{'D', 'F', 'B', 'U', 'S', 0, 0, 0};
+
+constexpr std::size_t alignUp(std::size_t size) {
+  // a cache line per slot header, the slots of the ring never share one
+  return (size + 63) & ~std::size_t{63};
+}
+
+std::int64_t now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+[[noreturn]] void throwError(const char *what, const std::string &name) {
+  std::ostringstream ss;
+  ss << what << " " << name;
+#ifdef FRAME_BUS_POSIX
+  ss << ": " << std::strerror(errno);
+#endif
+  throw std::runtime_error(ss.str());
+}
+
+#ifdef __linux__
+std::uint32_t *getFutex(const FrameBus::Header *header) {
+  // the atomic has the representation of its value, the kernel compares that word
+  return reinterpret_cast<std::uint32_t *>(const_cast<std::atomic<std::uint32_t> *>(&header->futex));
+}
+#endif
+}// namespace
+
+#ifdef FRAME_BUS_POSIX
+FrameBusPublisher::FrameBusPublisher(const std::string &name, int width, int height, const std::uint8_t *palette,
+                                     int numColors, std::uint32_t slotCount)
+    : m_name(name) {
+  slotCount = std::max(slotCount, 2u);
+  const auto slotOffset = alignUp(sizeof(FrameBus::Header));
+  const auto slotSize = alignUp(FrameBus::ImageOffset + static_cast<std::size_t>(width) * height);
+  m_size = slotOffset + slotSize * slotCount;
+
+  // a stale object of a crashed run would have another size, the readers of the old one keep it
+  ::shm_unlink(name.c_str());
+  auto fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd == -1)
+    throwError("Unable to create the shared memory object", name);
+  if (::ftruncate(fd, static_cast<off_t>(m_size)) == -1) {
+    ::close(fd);
+    ::shm_unlink(name.c_str());
+    throwError("Unable to size the shared memory object", name);
+  }
+  auto data = ::mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    ::shm_unlink(name.c_str());
+    throwError("Unable to map the shared memory object", name);
+  }
+  m_data = static_cast<std::uint8_t *>(data);
+
+  // the object is zero-filled, the atomics are constructed in place
+  m_header = new (m_data) FrameBus::Header{};
+  m_header->version = FrameBus::Version;
+  m_header->slotCount = slotCount;
+  m_header->slotOffset = static_cast<std::uint32_t>(slotOffset);
+  m_header->slotSize = static_cast<std::uint32_t>(slotSize);
+  m_header->width = static_cast<std::uint32_t>(width);
+  m_header->height = static_cast<std::uint32_t>(height);
+  m_header->numColors = static_cast<std::uint32_t>(std::clamp(numColors, 0, 256));
+  std::memcpy(m_header->palette, palette, m_header->numColors * 3);
+  for (std::uint32_t i = 0; i < slotCount; ++i) {
+    new (m_data + slotOffset + i * slotSize) FrameBus::Slot{};
+  }
+  // a reader opening the object now sees the magic last
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(m_header->magic, Magic, sizeof(Magic));
+}
+
+FrameBusPublisher::~FrameBusPublisher() {
+  m_header->closed.store(1);
+  m_header->futex.fetch_add(1);
+#ifdef __linux__
+  ::syscall(SYS_futex, getFutex(m_header), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif
+  ::munmap(m_data, m_size);
+  ::shm_unlink(m_name.c_str());
+}
+
+void FrameBusPublisher::publish(const std::uint8_t *indices, int width, int height) {
+  const auto start = std::chrono::steady_clock::now();
+  const auto published = m_header->published.load(std::memory_order_relaxed);
+  auto slotData = m_data + m_header->slotOffset + (published % m_header->slotCount) * m_header->slotSize;
+  auto slot = reinterpret_cast<FrameBus::Slot *>(slotData);
+
+  // seqlock: the odd sequence is visible before any byte of the frame changes
+  const auto sequence = slot->sequence.load(std::memory_order_relaxed);
+  slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  slot->frame = published;
+  slot->timestamp = now();
+  const auto busWidth = static_cast<int>(m_header->width);
+  const auto busHeight = static_cast<int>(m_header->height);
+  auto image = slotData + FrameBus::ImageOffset;
+  // the fire changes resolution, the bus keeps its size
+  Util::resample(indices, width, height, image, busWidth, busHeight);
+
+  slot->sequence.store(sequence + 2, std::memory_order_release);
+  m_header->published.store(published + 1);
+  m_header->futex.fetch_add(1);
+#ifdef __linux__
+  // a wake without sleepers is a short system call, cheaper than tracking them in shared memory
+  ::syscall(SYS_futex, getFutex(m_header), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif
+
+  m_stats.published++;
+  m_stats.publishTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+FrameBusReader::FrameBusReader(const std::string &name) {
+  auto fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+  struct stat info {};
+  if (fd == -1 || ::fstat(fd, &info) == -1) {
+    if (fd != -1) {
+      ::close(fd);
+    }
+    throwError("Unable to open the shared memory object", name);
+  }
+  m_size = static_cast<std::size_t>(info.st_size);
+  if (m_size < sizeof(FrameBus::Header)) {
+    ::close(fd);
+    throw std::runtime_error("The shared memory object " + name + " is not a frame bus");
+  }
+  auto data = ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED)
+    throwError("Unable to map the shared memory object", name);
+  m_data = static_cast<const std::uint8_t *>(data);
+  m_header = reinterpret_cast<const FrameBus::Header *>(m_data);
+
+  const auto valid = std::memcmp(m_header->magic, Magic, sizeof(Magic)) == 0;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (!valid || m_header->version != FrameBus::Version || m_header->slotCount == 0
+      || m_header->slotOffset + static_cast<std::size_t>(m_header->slotCount) * m_header->slotSize > m_size) {
+    ::munmap(const_cast<std::uint8_t *>(m_data), m_size);
+    throw std::runtime_error("The shared memory object " + name + " is not a frame bus of this version");
+  }
+  // the frames published before opening are not missed
+  m_published = m_header->published.load();
+}
+
+FrameBusReader::~FrameBusReader() {
+  ::munmap(const_cast<std::uint8_t *>(m_data), m_size);
+}
+
+bool FrameBusReader::wait(int timeoutMs) {
+  if (m_header->published.load() != m_published || isClosed())
+    return true;
+#ifdef __linux__
+  const auto value = m_header->futex.load();
+  // the publisher bumps the futex after the frame count, a frame published since is seen here or wakes the wait
+  if (m_header->published.load() == m_published) {
+    timespec timeout{timeoutMs / 1000, static_cast<long>(timeoutMs % 1000) * 1000000};
+    ::syscall(SYS_futex, getFutex(m_header), FUTEX_WAIT, value, &timeout, nullptr, 0);
+  }
+#else
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+  while (m_header->published.load() == m_published && !isClosed() && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+#endif
+  return m_header->published.load() != m_published;
+}
+
+bool FrameBusReader::acquire(Frame &frame) {
+  std::uint64_t published;
+  const std::uint8_t *slotData;
+  const FrameBus::Slot *slot;
+  std::uint32_t sequence;
+  for (;;) {
+    published = m_header->published.load(std::memory_order_acquire);
+    if (published == m_published)
+      return false;
+    slotData = m_data + m_header->slotOffset + ((published - 1) % m_header->slotCount) * m_header->slotSize;
+    slot = reinterpret_cast<const FrameBus::Slot *>(slotData);
+    sequence = slot->sequence.load(std::memory_order_acquire);
+    if ((sequence & 1u) == 0)
+      break;
+    // the publisher lapped the ring since the count was read and is rewriting the slot: the count has moved on
+    // to frames that are complete, returning would leave wait() with nothing to block on
+  }
+
+  m_missed += published - m_published - 1;
+  m_published = published;
+  frame.frame = slot->frame;
+  frame.timestamp = slot->timestamp;
+  frame.indices = slotData + FrameBus::ImageOffset;
+  frame.slot = slot;
+  frame.sequence = sequence;
+  return true;
+}
+
+bool FrameBusReader::validate(const Frame &frame) const {
+  // the reads of the frame happen before the sequence is checked again
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return frame.slot->sequence.load(std::memory_order_relaxed) == frame.sequence;
+}
+
+bool FrameBusReader::isClosed() const noexcept {
+  return m_header->closed.load() != 0;
+}
+#else
+FrameBusPublisher::FrameBusPublisher(const std::string &name, int, int, const std::uint8_t *, int, std::uint32_t)
+    : m_name(name) {
+  throw std::runtime_error("The frame bus needs POSIX shared memory");
+}
+
+FrameBusPublisher::~FrameBusPublisher() = default;
+
+void FrameBusPublisher::publish(const std::uint8_t *, int, int) {
+}
+
+FrameBusReader::FrameBusReader(const std::string &) {
+  throw std::runtime_error("The frame bus needs POSIX shared memory");
+}
+
+FrameBusReader::~FrameBusReader() = default;
+
+bool FrameBusReader::wait(int) {
+  return false;
+}
+
+bool FrameBusReader::acquire(Frame &) {
+  return false;
+}
+
+bool FrameBusReader::validate(const Frame &) const {
+  return false;
+}
+
+bool FrameBusReader::isClosed() const noexcept {
+  return true;
+}
+#endif
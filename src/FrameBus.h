@@ -0,0 +1,130 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/// Frames published to other processes of the machine through POSIX shared memory.
+///
+/// The shared object starts with a header (size of the images, palette, number of frames published) followed by
+/// a ring of slots, each one a seqlock: its sequence is odd while the publisher writes it. Readers find the latest
+/// slot from the header and read the image in place, then check the sequence has not moved: no copy, no socket,
+/// and the publisher never waits for a reader. On Linux readers can sleep on a futex until the next frame.
+namespace FrameBus {
+constexpr std::uint32_t Version = 1;
+constexpr std::uint32_t DefaultSlotCount = 4;
+constexpr const char *DefaultName = "/doom_fire";
+
+struct Header {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t slotCount;
+  /// Bytes from the start of the object to the first slot, and from one slot to the next.
+  std::uint32_t slotOffset;
+  std::uint32_t slotSize;
+  /// Size of the images, rows from top to bottom, one palette index per pixel.
+  std::uint32_t width;
+  std::uint32_t height;
+  std::uint32_t numColors;
+  std::uint8_t palette[256 * 3];
+  /// Number of frames published, the latest is in slot (published - 1) % slotCount.
+  alignas(64) std::atomic<std::uint64_t> published;
+  /// Changes with each frame, readers wait on it.
+  std::atomic<std::uint32_t> futex;
+  /// Set when the publisher quits, readers holding the object see no new frame.
+  std::atomic<std::uint32_t> closed;
+};
+
+struct Slot {
+  /// Odd while the slot is written.
+  alignas(64) std::atomic<std::uint32_t> sequence;
+  std::uint64_t frame;
+  /// std::chrono::steady_clock time of the publication in nanoseconds, the monotonic clock shared by the processes.
+  std::int64_t timestamp;
+};
+// the image follows the slot header
+constexpr std::size_t ImageOffset = 64;
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free && std::atomic<std::uint32_t>::is_always_lock_free,
+              "the atomics of the shared object must not need a lock local to a process");
+static_assert(sizeof(Slot) <= ImageOffset, "the image follows the slot header");
+}// namespace FrameBus
+
+/// Creates the shared object and publishes frames into it.
+class FrameBusPublisher {
+public:
+  struct Stats {
+    std::uint64_t published{0};
+    /// Time spent writing the frames, in milliseconds.
+    double publishTime{0};
+  };
+
+  /// \param name: Specifies the name of the shared memory object, starting with a slash; an existing one is replaced.
+  /// \param width: Specifies the width of the images, frames of another size are resampled.
+  /// \param height: Specifies the height of the images.
+  /// \param palette: Specifies the colors as RGB triplets, for the readers to expand the indices.
+  /// \param numColors: Specifies the number of colors of the palette, at most 256.
+  /// \param slotCount: Specifies the number of frames in the ring, the time a reader has to read a frame.
+  FrameBusPublisher(const std::string &name, int width, int height, const std::uint8_t *palette, int numColors,
+                    std::uint32_t slotCount = FrameBus::DefaultSlotCount);
+  /// Marks the bus as closed and removes its name, the readers keep their mapping.
+  ~FrameBusPublisher();
+
+  FrameBusPublisher(const FrameBusPublisher &) = delete;
+  FrameBusPublisher &operator=(const FrameBusPublisher &) = delete;
+
+  /// Writes a frame into the next slot and wakes the waiting readers.
+  /// \param indices: Specifies the palette indices, width * height bytes, rows from top to bottom.
+  void publish(const std::uint8_t *indices, int width, int height);
+
+  [[nodiscard]] const Stats &getStats() const noexcept { return m_stats; }
+  [[nodiscard]] const std::string &getName() const noexcept { return m_name; }
+
+private:
+  std::string m_name;
+  FrameBus::Header *m_header{nullptr};
+  std::uint8_t *m_data{nullptr};
+  std::size_t m_size{0};
+  Stats m_stats;
+};
+
+/// Opens a bus read-only and reads its latest frames in place.
+class FrameBusReader {
+public:
+  struct Frame {
+    std::uint64_t frame{0};
+    std::int64_t timestamp{0};
+    /// Points into the shared memory, valid until validate() says otherwise.
+    const std::uint8_t *indices{nullptr};
+    const FrameBus::Slot *slot{nullptr};
+    std::uint32_t sequence{0};
+  };
+
+  /// \param name: Specifies the name of the shared memory object, an exception is thrown when it is not a bus.
+  explicit FrameBusReader(const std::string &name);
+  ~FrameBusReader();
+
+  FrameBusReader(const FrameBusReader &) = delete;
+  FrameBusReader &operator=(const FrameBusReader &) = delete;
+
+  /// Waits for a frame newer than the last one acquired.
+  /// \param timeoutMs: Specifies how long to wait at most.
+  /// \return true when there is a new frame.
+  bool wait(int timeoutMs);
+  /// Returns the latest frame when it is newer than the last one acquired.
+  bool acquire(Frame &frame);
+  /// Returns true when the frame was not overwritten while it was read, otherwise what was read has to be discarded.
+  [[nodiscard]] bool validate(const Frame &frame) const;
+
+  /// Returns the number of frames published but never acquired, the reader was too slow for them.
+  [[nodiscard]] std::uint64_t getMissed() const noexcept { return m_missed; }
+  [[nodiscard]] bool isClosed() const noexcept;
+  [[nodiscard]] const FrameBus::Header &getHeader() const noexcept { return *m_header; }
+
+private:
+  const FrameBus::Header *m_header{nullptr};
+  const std::uint8_t *m_data{nullptr};
+  std::size_t m_size{0};
+  std::uint64_t m_published{0};
+  std::uint64_t m_missed{0};
+};
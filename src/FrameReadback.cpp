@@ -0,0 +1,197 @@
+#include "FrameReadback.h"
+#include "Debug.h"
+#include "GlCapabilities.h"
+#include "RenderTarget.h"
+#include <cstring>
+#include <utility>
+
+FrameReadback::FrameReadback(Consumer consumer)
+    : m_consumer(std::move(consumer)), m_dsa(GlCapabilities::get().directStateAccess),
+      m_sync(GlCapabilities::get().sync) {
+  m_worker = std::thread(&FrameReadback::run, this);
+}
+
+FrameReadback::~FrameReadback() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_condition.notify_one();
+  m_worker.join();
+
+  for (auto &slot : m_slots) {
+    if (slot.fence) {
+      glDeleteSync(slot.fence);
+    }
+  }
+}
+
+void FrameReadback::capture(const RenderTarget &source) {
+  auto &slot = m_slots[m_head];
+  m_captures++;
+  if (slot.pending) {
+    // waiting for the oldest readback would stall exactly like a plain glReadPixels
+    m_droppedInFlight++;
+    return;
+  }
+
+  const auto width = source.getWidth();
+  const auto height = source.getHeight();
+  const auto size = static_cast<std::size_t>(width) * height * 4;
+  if (!slot.buffer) {
+    slot.buffer = std::make_unique<VertexBuffer>(VertexBuffer::Type::PixelPack);
+  }
+  if (size > slot.capacity) {
+    slot.buffer->buffer(size, nullptr, VertexBuffer::Usage::Read);
+    slot.buffer->setLabel("readback");
+    slot.capacity = size;
+  }
+
+  // with a pack buffer bound glReadPixels only records the copy, the pointer is an offset in the buffer
+  GL_CHECK(glBindFramebuffer(GL_READ_FRAMEBUFFER, source.getHandle()));
+  GL_CHECK(glReadBuffer(source.getHandle() ? GL_COLOR_ATTACHMENT0 : GL_BACK));
+  GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer->getHandle()));
+  GL_CHECK(glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+  GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+  if (m_sync) {
+    GL_CHECK(slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+  }
+
+  slot.pending = true;
+  slot.index = m_captures - 1;
+  slot.frame = m_frames;
+  slot.issueTime = std::chrono::steady_clock::now();
+  slot.width = width;
+  slot.height = height;
+  m_head = (m_head + 1) % RingSize;
+}
+
+void FrameReadback::poll() {
+  m_frames++;
+  // the readbacks complete in order, the first one still running ends the search
+  while (m_slots[m_tail].pending) {
+    auto &slot = m_slots[m_tail];
+    if (m_sync) {
+      auto status = glClientWaitSync(slot.fence, 0, 0);
+      if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+        break;
+    } else if (m_frames - slot.frame < RingSize - 1) {
+      // without fences a readback is assumed complete once the ring has gone around
+      break;
+    }
+    collect(slot);
+    m_tail = (m_tail + 1) % RingSize;
+  }
+}
+
+void FrameReadback::finish() {
+  while (m_slots[m_tail].pending) {
+    auto &slot = m_slots[m_tail];
+    if (m_sync) {
+      auto status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+      while (status == GL_TIMEOUT_EXPIRED) {
+        status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+      }
+    }
+    collect(slot);
+    m_tail = (m_tail + 1) % RingSize;
+  }
+}
+
+void FrameReadback::collect(Slot &slot) {
+  if (slot.fence) {
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+  }
+  slot.pending = false;
+
+  std::unique_ptr<Frame> frame;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_pool.empty()) {
+      frame = std::move(m_pool.back());
+      m_pool.pop_back();
+    }
+  }
+  if (!frame) {
+    frame = std::make_unique<Frame>();
+  }
+
+  const auto size = static_cast<std::size_t>(slot.width) * slot.height * 4;
+  frame->index = slot.index;
+  frame->width = slot.width;
+  frame->height = slot.height;
+  frame->pixels.resize(size);
+  const void *data;
+  if (m_dsa) {
+    GL_CHECK(data = glMapNamedBufferRange(slot.buffer->getHandle(), 0, size, GL_MAP_READ_BIT));
+    if (data) {
+      std::memcpy(frame->pixels.data(), data, size);
+      GL_CHECK(glUnmapNamedBuffer(slot.buffer->getHandle()));
+    }
+  } else {
+    GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer->getHandle()));
+    GL_CHECK(data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT));
+    if (data) {
+      std::memcpy(frame->pixels.data(), data, size);
+      GL_CHECK(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+    }
+    GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+  }
+  // a lost context or an out of memory error leaves the buffer unmapped
+  if (!data) {
+    m_droppedUnmapped++;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pool.push_back(std::move(frame));
+    return;
+  }
+
+  std::chrono::duration<double, std::milli> latency = std::chrono::steady_clock::now() - slot.issueTime;
+  m_totalLatency += latency.count();
+  m_totalLatencyFrames += m_frames - slot.frame;
+  m_collected++;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_queue.size() >= QueueSize) {
+      m_droppedByConsumer++;
+      m_pool.push_back(std::move(frame));
+      return;
+    }
+    m_queue.push_back(std::move(frame));
+  }
+  m_condition.notify_one();
+}
+
+void FrameReadback::run() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true) {
+    m_condition.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+    // the queued frames are still delivered when stopping
+    if (m_queue.empty())
+      break;
+    auto frame = std::move(m_queue.front());
+    m_queue.pop_front();
+
+    lock.unlock();
+    m_consumer(*frame);
+    m_delivered++;
+    lock.lock();
+    m_pool.push_back(std::move(frame));
+  }
+}
+
+FrameReadback::Stats FrameReadback::getStats() const {
+  Stats stats;
+  stats.captured = m_captures;
+  stats.droppedInFlight = m_droppedInFlight;
+  stats.droppedUnmapped = m_droppedUnmapped;
+  stats.delivered = m_delivered;
+  if (m_collected > 0) {
+    stats.latency = static_cast<float>(m_totalLatency / static_cast<double>(m_collected));
+    stats.latencyFrames = static_cast<float>(m_totalLatencyFrames) / static_cast<float>(m_collected);
+  }
+  std::lock_guard<std::mutex> lock(m_mutex);
+  stats.droppedByConsumer = m_droppedByConsumer;
+  return stats;
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <GL/glew.h>
+#include "VertexBuffer.h"
+
+class RenderTarget;
+
+/// Reads rendered frames back to the CPU without stalling the pipeline.
+///
+/// glReadPixels writes into a ring of pixel pack buffers, so it returns immediately. A fence is inserted after
+/// each readback and checked on later frames; the completed ones are copied out of their buffer and handed to
+/// a consumer running on a worker thread. When every buffer is still in flight, or when the consumer lags behind,
+/// frames are dropped rather than waited for.
+class FrameReadback {
+public:
+  static constexpr std::size_t RingSize = 3;
+  /// Number of frames waiting for the consumer before new ones are dropped.
+  static constexpr std::size_t QueueSize = 4;
+
+  struct Frame {
+    /// Number of the capture() call that produced the frame.
+    std::uint64_t index{0};
+    int width{0};
+    int height{0};
+    /// RGBA pixels, rows from bottom to top as OpenGL reads them.
+    std::vector<std::uint8_t> pixels;
+  };
+  using Consumer = std::function<void(const Frame &frame)>;
+
+  struct Stats {
+    /// Number of readbacks issued.
+    std::uint64_t captured{0};
+    /// Number of frames the consumer has processed.
+    std::uint64_t delivered{0};
+    /// Number of frames not read because every buffer of the ring was still in flight.
+    std::uint64_t droppedInFlight{0};
+    /// Number of frames lost because their buffer could not be mapped.
+    std::uint64_t droppedUnmapped{0};
+    /// Number of frames read but discarded because the consumer was late.
+    std::uint64_t droppedByConsumer{0};
+    /// Average time in milliseconds from capture() to the frame being queued for the consumer.
+    float latency{0};
+    /// Average number of frames from capture() to the frame being queued for the consumer.
+    float latencyFrames{0};
+  };
+
+  /// \param consumer: Specifies the function called on the worker thread with each completed frame.
+  explicit FrameReadback(Consumer consumer);
+  /// The frames already queued are delivered before the worker stops, the readbacks still in flight are lost.
+  ~FrameReadback();
+
+  FrameReadback(const FrameReadback &) = delete;
+  FrameReadback &operator=(const FrameReadback &) = delete;
+
+  /// Issues the readback of the color buffer of a target, it has to be called once per frame at most.
+  void capture(const RenderTarget &source);
+  /// Queues the readbacks the GPU has completed, it has to be called once per frame.
+  void poll();
+  /// Waits for the readbacks in flight and queues them, before the last frames are needed.
+  void finish();
+
+  [[nodiscard]] Stats getStats() const;
+
+private:
+  struct Slot {
+    std::unique_ptr<VertexBuffer> buffer;
+    std::size_t capacity{0};
+    GLsync fence{nullptr};
+    bool pending{false};
+    std::uint64_t index{0};
+    // value of the poll() counter and time when the readback was issued
+    std::uint64_t frame{0};
+    std::chrono::steady_clock::time_point issueTime{};
+    int width{0};
+    int height{0};
+  };
+
+  // copies a completed slot into a frame of the pool and queues it for the worker
+  void collect(Slot &slot);
+  void run();
+
+private:
+  Consumer m_consumer;
+  bool m_dsa;
+  bool m_sync;
+  std::array<Slot, RingSize> m_slots{};
+  // next slot to write, and oldest slot in flight
+  std::size_t m_head{0};
+  std::size_t m_tail{0};
+  std::uint64_t m_captures{0};
+  std::uint64_t m_frames{0};
+  std::uint64_t m_droppedInFlight{0};
+  std::uint64_t m_droppedUnmapped{0};
+  std::uint64_t m_collected{0};
+  double m_totalLatency{0};
+  std::uint64_t m_totalLatencyFrames{0};
+
+  // shared with the worker
+  mutable std::mutex m_mutex;
+  std::condition_variable m_condition;
+  std::deque<std::unique_ptr<Frame>> m_queue;
+  std::vector<std::unique_ptr<Frame>> m_pool;
+  std::uint64_t m_droppedByConsumer{0};
+  std::atomic<std::uint64_t> m_delivered{0};
+  bool m_stop{false};
+  std::thread m_worker;
+};
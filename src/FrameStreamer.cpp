@@ -0,0 +1,216 @@
+#include "FrameStreamer.h"
+#include "Util.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+// spinning a little catches the next frame without a context switch, then the waiting side sleeps
+constexpr int SpinCount = 64;
+constexpr auto SleepTime = std::chrono::microseconds(200);
+
+void backoff(int &attempts) {
+  if (attempts++ < SpinCount) {
+    std::this_thread::yield();
+  } else {
+    std::this_thread::sleep_for(SleepTime);
+  }
+}
+
+std::uint8_t toByte(float value) {
+  return static_cast<std::uint8_t>(std::clamp(std::lround(value), 0l, 255l));
+}
+}// namespace
+
+FrameStreamer::FrameStreamer(const StreamSettings &settings, int width, int height, const std::uint8_t *palette,
+                             int numColors, int fps)
+    : m_settings(settings), m_width(width), m_height(height), m_expander(palette, numColors) {
+  if (m_settings.path == "-") {
+    m_file = stdout;
+  } else {
+    // opening a FIFO waits for its reader
+    m_file = std::fopen(m_settings.path.c_str(), "wb");
+  }
+  if (!m_file) {
+    std::ostringstream ss;
+    ss << "Unable to open the stream output " << m_settings.path;
+    throw std::runtime_error(ss.str());
+  }
+
+  // BT.601 limited range, the default of Y4M readers
+  numColors = std::clamp(numColors, 0, 256);
+  for (auto i = 0; i < numColors; ++i) {
+    const auto r = static_cast<float>(palette[i * 3]);
+    const auto g = static_cast<float>(palette[i * 3 + 1]);
+    const auto b = static_cast<float>(palette[i * 3 + 2]);
+    m_yuv[0][i] = toByte(16.f + (65.481f * r + 128.553f * g + 24.966f * b) / 255.f);
+    m_yuv[1][i] = toByte(128.f + (-37.797f * r - 74.203f * g + 112.f * b) / 255.f);
+    m_yuv[2][i] = toByte(128.f + (112.f * r - 93.786f * g - 18.214f * b) / 255.f);
+  }
+  // indices past the end of the palette are black, as with the RGBA output
+  for (auto i = numColors; i < 256; ++i) {
+    m_yuv[0][i] = 16;
+    m_yuv[1][i] = 128;
+    m_yuv[2][i] = 128;
+  }
+
+  for (std::size_t i = 0; i < QueueSize; ++i) {
+    m_free.tryPush(std::make_unique<std::vector<std::uint8_t>>(static_cast<std::size_t>(width) * height));
+  }
+  writeHeader(fps);
+  m_start = std::chrono::steady_clock::now();
+  m_writer = std::thread(&FrameStreamer::run, this);
+}
+
+FrameStreamer::~FrameStreamer() {
+  m_stop.store(true, std::memory_order_release);
+  m_writer.join();
+  if (m_file != stdout) {
+    std::fclose(m_file);
+  } else {
+    std::fflush(m_file);
+  }
+}
+
+void FrameStreamer::writeHeader(int fps) {
+  if (m_settings.format != StreamFormat::Y4m)
+    return;
+  // the chroma of the 4:2:0 planes is averaged over 2x2 pixels, sited at their center as in JPEG
+  std::ostringstream ss;
+  ss << "YUV4MPEG2 W" << m_width << " H" << m_height << " F" << fps << ":1 Ip A1:1 C420jpeg XYSCSS=420JPEG\n";
+  const auto header = ss.str();
+  write(header.data(), header.size());
+}
+
+bool FrameStreamer::push(const std::uint8_t *indices, int width, int height) {
+  if (isClosed())
+    return false;
+
+  Buffer buffer;
+  if (!m_free.tryPop(buffer)) {
+    if (m_settings.policy == StreamPolicy::Drop) {
+      m_dropped++;
+      return false;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    int attempts = 0;
+    while (!m_free.tryPop(buffer)) {
+      if (isClosed())
+        return false;
+      backoff(attempts);
+    }
+    m_blockedTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  auto &image = *buffer;
+  // the fire changes resolution, the video keeps its size
+  Util::resample(indices, width, height, image.data(), m_width, m_height);
+  // there are as many buffers as slots, the queue cannot be full
+  m_frames.tryPush(std::move(buffer));
+  m_pushed++;
+  return true;
+}
+
+void FrameStreamer::finish() {
+  int attempts = 0;
+  while (!isClosed() && m_written.load(std::memory_order_relaxed) < m_pushed) {
+    backoff(attempts);
+  }
+}
+
+void FrameStreamer::run() {
+  Buffer buffer;
+  int attempts = 0;
+  while (true) {
+    if (!m_frames.tryPop(buffer)) {
+      // the frames queued before the stop are still written
+      if (m_stop.load(std::memory_order_acquire) && m_frames.size() == 0)
+        break;
+      backoff(attempts);
+      continue;
+    }
+    attempts = 0;
+    if (!isClosed()) {
+      writeFrame(*buffer);
+    }
+    m_free.tryPush(std::move(buffer));
+  }
+}
+
+void FrameStreamer::writeFrame(const std::vector<std::uint8_t> &indices) {
+  const auto numPixels = static_cast<std::size_t>(m_width) * m_height;
+  switch (m_settings.format) {
+  case StreamFormat::Y4m: {
+    static constexpr char FrameHeader[] = "FRAME\n";
+    constexpr auto HeaderSize = sizeof(FrameHeader) - 1;
+    const auto chromaWidth = (m_width + 1) / 2;
+    const auto chromaHeight = (m_height + 1) / 2;
+    const auto chromaSize = static_cast<std::size_t>(chromaWidth) * chromaHeight;
+    m_output.resize(HeaderSize + numPixels + chromaSize * 2);
+    std::memcpy(m_output.data(), FrameHeader, HeaderSize);
+
+    auto luma = m_output.data() + HeaderSize;
+    for (std::size_t i = 0; i < numPixels; ++i) {
+      luma[i] = m_yuv[0][indices[i]];
+    }
+    auto cb = luma + numPixels;
+    auto cr = cb + chromaSize;
+    for (auto y = 0; y < chromaHeight; ++y) {
+      // the last row and column are repeated when the size is odd
+      auto row0 = indices.data() + static_cast<std::size_t>(y * 2) * m_width;
+      auto row1 = indices.data() + static_cast<std::size_t>(std::min(y * 2 + 1, m_height - 1)) * m_width;
+      for (auto x = 0; x < chromaWidth; ++x) {
+        const auto x0 = x * 2;
+        const auto x1 = std::min(x0 + 1, m_width - 1);
+        for (auto plane = 1; plane <= 2; ++plane) {
+          const auto &table = m_yuv[plane];
+          const auto sum = table[row0[x0]] + table[row0[x1]] + table[row1[x0]] + table[row1[x1]];
+          (plane == 1 ? cb : cr)[static_cast<std::size_t>(y) * chromaWidth + x] = static_cast<std::uint8_t>((sum + 2) / 4);
+        }
+      }
+    }
+    write(m_output.data(), m_output.size());
+    break;
+  }
+  case StreamFormat::Rgba:
+    m_output.resize(numPixels * 4);
+    m_expander.expand(indices.data(), m_output.data(), numPixels);
+    write(m_output.data(), m_output.size());
+    break;
+  case StreamFormat::Indexed:
+    write(indices.data(), numPixels);
+    break;
+  }
+  if (!isClosed()) {
+    // the reader gets each frame as soon as it is complete
+    std::fflush(m_file);
+    m_written.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void FrameStreamer::write(const void *data, std::size_t size) {
+  if (std::fwrite(data, 1, size, m_file) != size) {
+    if (!m_closed.exchange(true)) {
+      std::cerr << "Stream output " << m_settings.path << " closed after " << m_written.load() << " frame(s)\n";
+    }
+    return;
+  }
+  m_bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+FrameStreamer::Stats FrameStreamer::getStats() const {
+  Stats stats;
+  stats.pushed = m_pushed;
+  stats.dropped = m_dropped;
+  stats.blockedTime = m_blockedTime;
+  stats.written = m_written.load(std::memory_order_relaxed);
+  stats.bytes = m_bytes.load(std::memory_order_relaxed);
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - m_start;
+  if (elapsed.count() > 0) {
+    stats.throughput = static_cast<double>(stats.bytes) / elapsed.count() / 1e6;
+  }
+  return stats;
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "PaletteExpander.h"
+#include "SpscQueue.h"
+
+enum class StreamFormat {
+  /// YUV4MPEG2, 4:2:0 with BT.601 limited range, what most encoders read from a pipe without any option.
+  Y4m,
+  /// RGBA pixels, 4 bytes each, rows from top to bottom.
+  Rgba,
+  /// The palette indices as they are, 1 byte each.
+  Indexed,
+};
+
+/// What happens to a frame when the writer is late.
+enum class StreamPolicy {
+  /// The producer waits for a free buffer: no frame is lost, the application slows down to the reader.
+  Block,
+  /// The frame is skipped: the application keeps its pace, the video has holes.
+  Drop,
+};
+
+struct StreamSettings {
+  /// File, FIFO or "-" for the standard output, empty when not streaming.
+  std::string path;
+  StreamFormat format{StreamFormat::Y4m};
+  StreamPolicy policy{StreamPolicy::Block};
+};
+
+/// Streams images of palette indices to a file or a pipe, for an encoder process to read.
+///
+/// The producer copies each image into a free buffer and hands it to a writer thread through a lock-free queue;
+/// the conversion to the output format and the writes happen on the writer thread. The buffers come back through
+/// a second queue, so the steady state allocates nothing and takes no lock.
+class FrameStreamer {
+public:
+  /// Number of frames in flight between the producer and the writer.
+  static constexpr std::size_t QueueSize = 8;
+
+  struct Stats {
+    std::uint64_t pushed{0};
+    std::uint64_t written{0};
+    /// Number of frames skipped because every buffer was in flight, with the Drop policy.
+    std::uint64_t dropped{0};
+    std::uint64_t bytes{0};
+    /// Time the producer waited for a free buffer, with the Block policy, in milliseconds.
+    double blockedTime{0};
+    /// Bytes written per second since the stream started, in MB/s.
+    double throughput{0};
+  };
+
+  /// Opens the output and writes the stream header.
+  /// \param settings: Specifies the output, its format and the backpressure policy.
+  /// \param width: Specifies the width of the video, images of another size are resampled.
+  /// \param height: Specifies the height of the video.
+  /// \param palette: Specifies the colors as RGB triplets.
+  /// \param numColors: Specifies the number of colors of the palette, at most 256.
+  /// \param fps: Specifies the frame rate written in the Y4M header.
+  FrameStreamer(const StreamSettings &settings, int width, int height, const std::uint8_t *palette, int numColors,
+                int fps);
+  /// Writes the frames in flight and closes the output.
+  ~FrameStreamer();
+
+  FrameStreamer(const FrameStreamer &) = delete;
+  FrameStreamer &operator=(const FrameStreamer &) = delete;
+
+  /// Queues an image, it has to be called from a single thread.
+  /// \param indices: Specifies the palette indices, width * height bytes, rows from top to bottom.
+  /// \return false when the frame has been dropped or the output is closed.
+  bool push(const std::uint8_t *indices, int width, int height);
+  /// Waits for the writer to write the queued frames.
+  void finish();
+
+  /// Returns true once a write has failed, when the reader has gone away for instance.
+  [[nodiscard]] bool isClosed() const noexcept { return m_closed.load(std::memory_order_relaxed); }
+  [[nodiscard]] Stats getStats() const;
+
+private:
+  using Buffer = std::unique_ptr<std::vector<std::uint8_t>>;
+
+  void writeHeader(int fps);
+  void run();
+  // converts the indices into m_output and writes it
+  void writeFrame(const std::vector<std::uint8_t> &indices);
+  void write(const void *data, std::size_t size);
+
+private:
+  StreamSettings m_settings;
+  int m_width;
+  int m_height;
+  std::FILE *m_file{nullptr};
+  PaletteExpander m_expander;
+  // palette converted to Y, Cb and Cr
+  std::array<std::array<std::uint8_t, 256>, 3> m_yuv{};
+  std::vector<std::uint8_t> m_output;
+
+  SpscQueue<Buffer> m_frames{QueueSize};
+  SpscQueue<Buffer> m_free{QueueSize};
+  std::atomic<bool> m_stop{false};
+  std::atomic<bool> m_closed{false};
+  std::chrono::steady_clock::time_point m_start;
+  // producer side
+  std::uint64_t m_pushed{0};
+  std::uint64_t m_dropped{0};
+  double m_blockedTime{0};
+  // writer side
+  std::atomic<std::uint64_t> m_written{0};
+  std::atomic<std::uint64_t> m_bytes{0};
+  std::thread m_writer;
+};
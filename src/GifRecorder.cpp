@@ -0,0 +1,267 @@
+#include "GifRecorder.h"
+#include "Util.h"
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+constexpr int MaxCodeSize = 12;
+constexpr int MaxCodes = 1 << MaxCodeSize;
+// open addressing table of the LZW strings, at most half full
+constexpr int HashBits = 13;
+constexpr int HashSize = 1 << HashBits;
+
+void writeShort(std::vector<std::uint8_t> &out, int value) {
+  // GIF is little-endian
+  out.push_back(static_cast<std::uint8_t>(value & 0xFF));
+  out.push_back(static_cast<std::uint8_t>((value >> 8) & 0xFF));
+}
+
+/// Packs variable size codes, least significant bit first, as GIF expects.
+class BitWriter {
+public:
+  explicit BitWriter(std::vector<std::uint8_t> &out) : m_out(out) {}
+
+  void write(int code, int size) {
+    m_buffer |= static_cast<std::uint32_t>(code) << m_count;
+    m_count += size;
+    while (m_count >= 8) {
+      m_out.push_back(static_cast<std::uint8_t>(m_buffer & 0xFF));
+      m_buffer >>= 8;
+      m_count -= 8;
+    }
+  }
+
+  void flush() {
+    if (m_count > 0) {
+      m_out.push_back(static_cast<std::uint8_t>(m_buffer & 0xFF));
+    }
+    m_buffer = 0;
+    m_count = 0;
+  }
+
+private:
+  std::vector<std::uint8_t> &m_out;
+  std::uint32_t m_buffer{0};
+  int m_count{0};
+};
+
+/// Compresses indices of minCodeSize bits with the GIF flavor of LZW.
+std::vector<std::uint8_t> compress(const std::vector<std::uint8_t> &indices, int minCodeSize) {
+  std::vector<std::uint8_t> out;
+  out.reserve(indices.size() / 2);
+  if (indices.empty())
+    return out;
+
+  const int clearCode = 1 << minCodeSize;
+  const int endCode = clearCode + 1;
+  const auto maxIndex = static_cast<std::uint8_t>(clearCode - 1);
+  // a string is a known prefix code followed by an index
+  std::vector<std::int32_t> keys(HashSize, -1);
+  std::vector<std::uint16_t> codes(HashSize);
+  int codeSize = minCodeSize + 1;
+  int nextCode = endCode + 1;
+
+  BitWriter writer(out);
+  writer.write(clearCode, codeSize);
+  int prefix = std::min(indices[0], maxIndex);
+  for (std::size_t i = 1; i < indices.size(); ++i) {
+    const int index = std::min(indices[i], maxIndex);
+    const auto key = (prefix << 8) | index;
+    auto slot = (static_cast<std::uint32_t>(key) * 2654435761u) >> (32 - HashBits);
+    while (keys[slot] != -1 && keys[slot] != key) {
+      slot = (slot + 1) & (HashSize - 1);
+    }
+    if (keys[slot] == key) {
+      prefix = codes[slot];
+      continue;
+    }
+
+    writer.write(prefix, codeSize);
+    if (nextCode < MaxCodes) {
+      keys[slot] = key;
+      codes[slot] = static_cast<std::uint16_t>(nextCode++);
+      // the decoder adds its strings one code late, it widens the codes after reading the next one
+      if (nextCode > (1 << codeSize) && codeSize < MaxCodeSize) {
+        codeSize++;
+      }
+    } else {
+      // the table is full, both sides start over
+      writer.write(clearCode, codeSize);
+      std::fill(keys.begin(), keys.end(), -1);
+      codeSize = minCodeSize + 1;
+      nextCode = endCode + 1;
+    }
+    prefix = index;
+  }
+
+  writer.write(prefix, codeSize);
+  // reading the last code, the decoder adds the last string and may widen the codes for the end code
+  if (nextCode == (1 << codeSize) && codeSize < MaxCodeSize) {
+    codeSize++;
+  }
+  writer.write(endCode, codeSize);
+  writer.flush();
+  return out;
+}
+}// namespace
+
+GifRecorder::GifRecorder(const std::string &path, int width, int height, const std::uint8_t *palette, int numColors,
+                         int delay, unsigned int threads)
+    : m_path(path), m_width(width), m_height(height), m_delay(delay) {
+  m_file.open(path, std::ios::binary | std::ios::trunc);
+  if (!m_file) {
+    std::ostringstream ss;
+    ss << "Unable to create the GIF file " << path;
+    throw std::runtime_error(ss.str());
+  }
+  numColors = std::clamp(numColors, 2, 256);
+  while ((1 << m_bits) < numColors) {
+    m_bits++;
+  }
+  writeHeader(palette, numColors);
+
+  if (threads == 0) {
+    threads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  for (auto i = 0u; i < threads; ++i) {
+    m_threads.emplace_back(&GifRecorder::run, this);
+  }
+}
+
+GifRecorder::~GifRecorder() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_condition.notify_all();
+  for (auto &thread : m_threads) {
+    thread.join();
+  }
+  // trailer
+  m_file.put(0x3B);
+}
+
+void GifRecorder::writeHeader(const std::uint8_t *palette, int numColors) {
+  std::vector<std::uint8_t> header{'G', 'I', 'F', '8', '9', 'a'};
+  // logical screen descriptor: global color table of 2^bits colors, 8 bits per primary
+  writeShort(header, m_width);
+  writeShort(header, m_height);
+  header.push_back(static_cast<std::uint8_t>(0x80 | (7 << 4) | (m_bits - 1)));
+  header.push_back(0);// background color
+  header.push_back(0);// pixel aspect ratio
+  const auto tableSize = static_cast<std::size_t>(1 << m_bits) * 3;
+  header.insert(header.end(), palette, palette + numColors * 3);
+  header.resize(header.size() + tableSize - numColors * 3, 0);
+
+  // NETSCAPE2.0 application extension: loop forever
+  const std::uint8_t loop[]{0x21, 0xFF, 0x0B, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 0x03, 0x01, 0x00, 0x00, 0x00};
+  header.insert(header.end(), std::begin(loop), std::end(loop));
+
+  m_file.write(reinterpret_cast<const char *>(header.data()), static_cast<std::streamsize>(header.size()));
+  m_bytes = header.size();
+}
+
+bool GifRecorder::addFrame(const std::uint8_t *indices, int width, int height) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_jobs.size() >= QueueSize) {
+    m_stats.dropped++;
+    return false;
+  }
+  Job job;
+  job.sequence = m_nextSequence++;
+  if (!m_freeBuffers.empty()) {
+    job.indices = std::move(m_freeBuffers.back());
+    m_freeBuffers.pop_back();
+  }
+  lock.unlock();
+
+  job.indices.resize(static_cast<std::size_t>(m_width) * m_height);
+  // the fire changes resolution, the animation keeps its size
+  Util::resample(indices, width, height, job.indices.data(), m_width, m_height);
+
+  lock.lock();
+  m_jobs.push_back(std::move(job));
+  m_stats.queued++;
+  lock.unlock();
+  m_condition.notify_one();
+  return true;
+}
+
+void GifRecorder::run() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true) {
+    m_condition.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+    // the queued frames are still encoded when stopping
+    if (m_jobs.empty())
+      break;
+    auto job = std::move(m_jobs.front());
+    m_jobs.pop_front();
+    lock.unlock();
+
+    const auto start = std::chrono::steady_clock::now();
+    auto encoded = encode(job.indices);
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+    {
+      // the file has its own lock, addFrame() never waits for a write
+      std::lock_guard<std::mutex> writeLock(m_writeMutex);
+      m_encoded.emplace(job.sequence, std::move(encoded));
+      // the frames finish out of order, the file receives them in order
+      for (auto it = m_encoded.find(m_nextWrite); it != m_encoded.end(); it = m_encoded.find(m_nextWrite)) {
+        m_file.write(reinterpret_cast<const char *>(it->second.data()), static_cast<std::streamsize>(it->second.size()));
+        m_bytes += it->second.size();
+        m_written++;
+        m_encoded.erase(it);
+        m_nextWrite++;
+      }
+    }
+
+    lock.lock();
+    m_stats.encodeTime += elapsed.count();
+    m_freeBuffers.push_back(std::move(job.indices));
+  }
+}
+
+std::vector<std::uint8_t> GifRecorder::encode(const std::vector<std::uint8_t> &indices) const {
+  std::vector<std::uint8_t> out;
+  // graphic control extension: no disposal, no transparency, delay
+  const std::uint8_t control[]{0x21, 0xF9, 0x04, 0x04};
+  out.insert(out.end(), std::begin(control), std::end(control));
+  writeShort(out, m_delay);
+  out.push_back(0);
+  out.push_back(0);
+
+  // image descriptor: the whole screen, no local color table
+  out.push_back(0x2C);
+  writeShort(out, 0);
+  writeShort(out, 0);
+  writeShort(out, m_width);
+  writeShort(out, m_height);
+  out.push_back(0);
+
+  out.push_back(static_cast<std::uint8_t>(m_bits));
+  const auto data = compress(indices, m_bits);
+  // the compressed data is split in sub-blocks of at most 255 bytes
+  for (std::size_t offset = 0; offset < data.size(); offset += 255) {
+    const auto size = std::min<std::size_t>(255, data.size() - offset);
+    out.push_back(static_cast<std::uint8_t>(size));
+    out.insert(out.end(), data.begin() + static_cast<std::ptrdiff_t>(offset),
+               data.begin() + static_cast<std::ptrdiff_t>(offset + size));
+  }
+  out.push_back(0);
+  return out;
+}
+
+GifRecorder::Stats GifRecorder::getStats() const {
+  Stats stats;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    stats = m_stats;
+  }
+  std::lock_guard<std::mutex> lock(m_writeMutex);
+  stats.written = m_written;
+  stats.bytes = m_bytes;
+  return stats;
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Records images of palette indices to an animated GIF, looping forever.
+///
+/// The indices are written as they are, with the palette as the global color table: there is no RGBA round-trip
+/// nor any color quantization. GIF frames are independent LZW streams, so they are compressed in parallel by
+/// a pool of encoder threads and written to the file in order by whichever thread finishes the next one.
+/// addFrame() only copies the image, frames are dropped when the encoders fall too far behind.
+class GifRecorder {
+public:
+  /// Number of frames waiting to be encoded before new ones are dropped.
+  static constexpr std::size_t QueueSize = 16;
+
+  struct Stats {
+    std::uint64_t queued{0};
+    std::uint64_t written{0};
+    /// Number of frames not recorded because the encoders were late.
+    std::uint64_t dropped{0};
+    /// Size of the file so far.
+    std::uint64_t bytes{0};
+    /// Time spent compressing, summed over the encoder threads, in milliseconds.
+    double encodeTime{0};
+  };
+
+  /// \param path: Specifies the file to write.
+  /// \param width: Specifies the width of the animation, frames of another size are resampled.
+  /// \param height: Specifies the height of the animation.
+  /// \param palette: Specifies the colors as RGB triplets.
+  /// \param numColors: Specifies the number of colors of the palette, at most 256.
+  /// \param delay: Specifies the time each frame is shown, in hundredths of a second.
+  /// \param threads: Specifies the number of encoder threads, 0 to use the hardware concurrency.
+  GifRecorder(const std::string &path, int width, int height, const std::uint8_t *palette, int numColors, int delay,
+              unsigned int threads = 0);
+  /// Encodes the queued frames and closes the file.
+  ~GifRecorder();
+
+  GifRecorder(const GifRecorder &) = delete;
+  GifRecorder &operator=(const GifRecorder &) = delete;
+
+  /// Queues a frame.
+  /// \param indices: Specifies the palette indices, width * height bytes, rows from top to bottom.
+  /// \return false when the frame has been dropped.
+  bool addFrame(const std::uint8_t *indices, int width, int height);
+
+  [[nodiscard]] Stats getStats() const;
+  [[nodiscard]] const std::string &getPath() const noexcept { return m_path; }
+
+private:
+  struct Job {
+    std::uint64_t sequence{0};
+    std::vector<std::uint8_t> indices;
+  };
+
+  void writeHeader(const std::uint8_t *palette, int numColors);
+  void run();
+  // compresses a frame, with its graphic control extension and image descriptor
+  [[nodiscard]] std::vector<std::uint8_t> encode(const std::vector<std::uint8_t> &indices) const;
+
+private:
+  std::string m_path;
+  int m_width;
+  int m_height;
+  int m_delay;
+  // bits per index: the size of the color table and the LZW minimum code size, which is at least 2
+  int m_bits{2};
+
+  mutable std::mutex m_mutex;
+  std::condition_variable m_condition;
+  std::deque<Job> m_jobs;
+  std::vector<std::vector<std::uint8_t>> m_freeBuffers;
+  std::uint64_t m_nextSequence{0};
+  bool m_stop{false};
+  Stats m_stats{};
+
+  mutable std::mutex m_writeMutex;
+  // encoded frames waiting for the ones before them, and the next one to write
+  std::map<std::uint64_t, std::vector<std::uint8_t>> m_encoded;
+  std::uint64_t m_nextWrite{0};
+  std::uint64_t m_written{0};
+  std::uint64_t m_bytes{0};
+  std::ofstream m_file;
+  std::vector<std::thread> m_threads;
+};
@@ -0,0 +1,40 @@
+#pragma once
+#include <GL/glew.h>
+
+/// Optional OpenGL features detected once the context has been created.
+struct GlCapabilities {
+  /// GL 4.5 or ARB_direct_state_access: objects are edited by name instead of bind-to-edit.
+  bool directStateAccess{false};
+  /// GL 4.4 or ARB_buffer_storage: immutable buffers that can stay mapped while the GPU reads them.
+  bool bufferStorage{false};
+  /// GL 4.1 or ARB_get_program_binary with at least one binary format: linked programs can be saved and reloaded.
+  bool programBinary{false};
+  /// GL 4.3 or KHR_debug in a build configured with DOOMFIRE_GL_DEBUG_OUTPUT: errors come from a callback, objects are labeled.
+  bool debugOutput{false};
+  /// GL 3.3 or ARB_timer_query: GPU timestamps.
+  bool timerQuery{false};
+  /// GL 3.2 or ARB_sync: fences tell when the GPU has executed the commands issued before them.
+  bool sync{false};
+
+  static GlCapabilities &get() {
+    static GlCapabilities caps;
+    return caps;
+  }
+
+  /// Detects the features of the current context, it has to be called after glewInit.
+  static void detect() {
+    auto &caps = get();
+    caps.directStateAccess = GLEW_VERSION_4_5 || GLEW_ARB_direct_state_access;
+    caps.bufferStorage = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+    caps.timerQuery = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+    caps.sync = GLEW_VERSION_3_2 || GLEW_ARB_sync;
+    if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary) {
+      GLint numFormats = 0;
+      glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+      caps.programBinary = numFormats > 0;
+    }
+#ifdef USE_GL_DEBUG_OUTPUT
+    caps.debugOutput = GLEW_VERSION_4_3 || GLEW_KHR_debug;
+#endif
+  }
+};
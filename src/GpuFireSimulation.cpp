@@ -0,0 +1,135 @@
+#include "GpuFireSimulation.h"
+#include "FireSimulation.h"
+
+static const char *vertexShaderSource =
+    R"(#version 330 core
+void main()
+{
+  vec2 pos = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+  gl_Position = vec4(pos * 2.0 - 1.0, 0.0, 1.0);
+})";
+
+// The CPU rule scatters every pixel to the row above at a random column offset of -1..1, column
+// after column from left to right, so that:
+// - the last of the candidate sources of a pixel wins,
+// - a column reads the values the column on its left has just spread into it (offset +1), which
+//   lets the fire climb diagonally several rows in a single tick.
+// The shader gathers the same result: each source pixel draws its offset from a hash of its
+// position and the tick, readValue() rebuilds the value a column reads by walking that diagonal
+// chain, then the destination takes the candidate sources in reverse processing order.
+static const char *fragmentShaderSource =
+    R"(#version 330 core
+uniform usampler2D src_tex;
+uniform int seed;
+out uint value;
+
+const int MaxChain = 32;
+ivec2 size;
+
+// picks 0, 1 or 2 from a hash of the position and the per-tick seed
+int randIdx(ivec2 p)
+{
+  uint x = uint(p.x + p.y * size.x) ^ uint(seed);
+  x ^= x >> 16;
+  x *= 0x7feb352dU;
+  x ^= x >> 15;
+  x *= 0x846ca68bU;
+  return int(((x >> 16) * 3U) >> 16);
+}
+
+uint readValue(ivec2 p)
+{
+  int k = 0;
+  while (k < MaxChain && p.x - k - 1 >= 0 && p.y + k + 1 < size.y && randIdx(p + ivec2(-k - 1, k + 1)) == 0) {
+    k++;
+  }
+  uint v = texelFetch(src_tex, p + ivec2(-k, k), 0).x;
+  for (int i = k; i > 0; --i) {
+    if (v == 0U) {
+      v = texelFetch(src_tex, p + ivec2(1 - i, i - 1), 0).x;
+    }
+  }
+  return v;
+}
+
+void main()
+{
+  size = textureSize(src_tex, 0);
+  ivec2 p = ivec2(gl_FragCoord.xy);
+  value = texelFetch(src_tex, p, 0).x;
+  if (p.y == size.y - 1) {
+    return;
+  }
+
+  ivec2 right = ivec2(p.x + 1, p.y + 1);
+  if (right.x < size.x && randIdx(right) == 2) {
+    uint pixel = readValue(right);
+    if (pixel != 0U) {
+      value = pixel;
+      return;
+    }
+  }
+  ivec2 below = ivec2(p.x, p.y + 1);
+  uint pixel = readValue(below);
+  if (pixel == 0U) {
+    value = 0U;
+    return;
+  }
+  if (randIdx(below) == 1) {
+    value = pixel - 1U;
+    return;
+  }
+  ivec2 left = ivec2(p.x - 1, p.y + 1);
+  if (left.x >= 0 && randIdx(left) == 0) {
+    pixel = readValue(left);
+    if (pixel != 0U) {
+      value = pixel;
+    }
+  }
+})";
+
+// scrambles the tick counter into the seed of the per-pixel hash
+static std::uint32_t hash(std::uint32_t x) {
+  x ^= x >> 16;
+  x *= 0x7feb352dU;
+  x ^= x >> 15;
+  x *= 0x846ca68bU;
+  x ^= x >> 16;
+  return x;
+}
+
+GpuFireSimulation::GpuFireSimulation(int width, int height)
+    : m_width(width), m_height(height) {
+  for (auto &target : m_targets) {
+    target = std::make_unique<RenderTarget>(width, height, Texture::Format::Index);
+  }
+  m_shader = std::make_unique<Shader>(vertexShaderSource, fragmentShaderSource);
+  m_srcHandle = m_shader->getUniformHandle("src_tex");
+  m_seedHandle = m_shader->getUniformHandle("seed");
+  m_targets[0]->setLabel("gpu fire ping");
+  m_targets[1]->setLabel("gpu fire pong");
+  m_shader->setLabel("gpu fire simulation");
+  m_vao.setLabel("gpu fire fullscreen triangle");
+  reset();
+}
+
+void GpuFireSimulation::reset() {
+  FireSimulation fire(m_width, m_height);
+  for (auto &target : m_targets) {
+    target->getTexture()->setData(m_width, m_height, fire.getImage());
+  }
+  m_tick = 0;
+}
+
+void GpuFireSimulation::update() {
+  const auto &src = *m_targets[m_current]->getTexture();
+  m_current = 1 - m_current;
+
+  m_shader->setUniform(m_srcHandle, src);
+  m_shader->setUniform(m_seedHandle, static_cast<int>(hash(m_tick)));
+  m_targets[m_current]->bind();
+  m_vao.bind();
+  m_targets[m_current]->draw(PrimitiveType::Triangles, 0, 3, m_shader.get());
+  VertexArray::unbind();
+  m_tick++;
+}
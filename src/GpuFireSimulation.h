@@ -0,0 +1,42 @@
+#pragma once
+#include <array>
+#include <memory>
+#include "RenderTarget.h"
+#include "Shader.h"
+#include "VertexArray.h"
+
+/// GPU implementation of the fire: the image lives in two GL_R8UI textures attached to framebuffers
+/// and each tick renders one into the other, so nothing is computed nor uploaded by the CPU.
+///
+/// Unlike FireSimulation the columns do not wrap around: its flat indexing spreads the last column into the first
+/// one of the same row, and the first column into the last one two rows up. The pixels spreading out of the image
+/// are dropped here, so the fire is a little dimmer along the left and right edges than the CPU one.
+class GpuFireSimulation {
+public:
+  GpuFireSimulation(int width, int height);
+
+  /// Clears the image and lights the bottom row.
+  void reset();
+  /// Advances the fire by one tick, it leaves the simulation framebuffer bound.
+  void update();
+
+  /// Returns the index texture written by the latest tick.
+  [[nodiscard]] const Texture &getTexture() const { return *m_targets[m_current]->getTexture(); }
+  /// Returns the index texture of the tick before.
+  [[nodiscard]] const Texture &getPreviousTexture() const { return *m_targets[1 - m_current]->getTexture(); }
+
+  [[nodiscard]] int getWidth() const noexcept { return m_width; }
+  [[nodiscard]] int getHeight() const noexcept { return m_height; }
+
+private:
+  int m_width;
+  int m_height;
+  std::uint32_t m_tick{0};
+  int m_current{0};
+  std::array<std::unique_ptr<RenderTarget>, 2> m_targets{};
+  std::unique_ptr<Shader> m_shader{};
+  Shader::UniformHandle m_srcHandle{-1};
+  Shader::UniformHandle m_seedHandle{-1};
+  // the fullscreen triangle is generated from gl_VertexID but core profiles still need a vertex array
+  VertexArray m_vao{};
+};
@@ -0,0 +1,108 @@
+#include "GpuProfiler.h"
+#include "Debug.h"
+#include "GlCapabilities.h"
+#include <algorithm>
+#include <cassert>
+
+GpuProfiler::GpuProfiler() : m_available(GlCapabilities::get().timerQuery) {
+}
+
+GpuProfiler::~GpuProfiler() {
+  for (auto &frame : m_frames) {
+    if (!frame.queries.empty()) {
+      GL_CHECK(glDeleteQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data()));
+    }
+  }
+}
+
+GpuProfiler::Phase GpuProfiler::addPhase(std::string name) {
+  m_phases.push_back({std::move(name)});
+  return static_cast<Phase>(m_phases.size() - 1);
+}
+
+void GpuProfiler::begin(Phase phase) {
+  assert(phase >= 0 && static_cast<std::size_t>(phase) < m_phases.size());
+  assert(m_phases[phase].openRange == -1);
+  if (!m_available)
+    return;
+
+  auto &frame = m_frames[m_frame];
+  auto query = nextQuery(frame);
+  GL_CHECK(glQueryCounter(query, GL_TIMESTAMP));
+  m_phases[phase].openRange = static_cast<int>(frame.ranges.size());
+  frame.ranges.push_back({phase, query, 0});
+}
+
+void GpuProfiler::end(Phase phase) {
+  if (!m_available)
+    return;
+
+  auto &frame = m_frames[m_frame];
+  auto &info = m_phases[phase];
+  assert(info.openRange >= 0);
+  auto query = nextQuery(frame);
+  GL_CHECK(glQueryCounter(query, GL_TIMESTAMP));
+  frame.ranges[info.openRange].end = query;
+  info.openRange = -1;
+}
+
+void GpuProfiler::endFrame() {
+  if (!m_available)
+    return;
+
+  // the oldest frame is about to be reused, read it if the GPU is done with it
+  m_frame = (m_frame + 1) % FramesInFlight;
+  auto &frame = m_frames[m_frame];
+  collect(frame);
+  frame.ranges.clear();
+  frame.usedQueries = 0;
+}
+
+float GpuProfiler::getAverage(Phase phase) const {
+  const auto count = std::min(m_collectedFrames, HistorySize);
+  if (count == 0)
+    return 0;
+  float sum = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    sum += m_phases[phase].history[(m_historyOffset + HistorySize - 1 - i) % HistorySize];
+  }
+  return sum / static_cast<float>(count);
+}
+
+GLuint GpuProfiler::nextQuery(Frame &frame) {
+  if (frame.usedQueries == frame.queries.size()) {
+    GLuint query;
+    GL_CHECK(glGenQueries(1, &query));
+    frame.queries.push_back(query);
+  }
+  return frame.queries[frame.usedQueries++];
+}
+
+void GpuProfiler::collect(Frame &frame) {
+  if (frame.ranges.empty())
+    return;
+
+  // queries complete in order, the last one being ready means the whole frame is
+  GLint available = GL_FALSE;
+  GL_CHECK(glGetQueryObjectiv(frame.queries[frame.usedQueries - 1], GL_QUERY_RESULT_AVAILABLE, &available));
+  if (available == GL_FALSE) {
+    ++m_dropped;
+    return;
+  }
+
+  std::vector<float> times(m_phases.size(), 0.f);
+  for (const auto &range : frame.ranges) {
+    if (range.end == 0)
+      continue;
+    GLuint64 begin = 0, end = 0;
+    GL_CHECK(glGetQueryObjectui64v(range.begin, GL_QUERY_RESULT, &begin));
+    GL_CHECK(glGetQueryObjectui64v(range.end, GL_QUERY_RESULT, &end));
+    times[range.phase] += static_cast<float>(end - begin) / 1e6f;
+  }
+
+  for (std::size_t i = 0; i < m_phases.size(); ++i) {
+    m_phases[i].history[m_historyOffset] = times[i];
+  }
+  m_historyOffset = (m_historyOffset + 1) % HistorySize;
+  ++m_collectedFrames;
+}
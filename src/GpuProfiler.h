@@ -0,0 +1,99 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+
+/// Measures the GPU time of the phases of a frame with GL_TIMESTAMP query pairs.
+///
+/// Results are read back FramesInFlight frames later and only if the GPU has already written them,
+/// so profiling never waits for the GPU. A phase can be measured several times per frame, its samples are summed.
+class GpuProfiler {
+public:
+  using Phase = int;
+  static constexpr std::size_t FramesInFlight = 4;
+  static constexpr std::size_t HistorySize = 120;
+
+  /// Measures the GL commands issued during its lifetime.
+  class Scope {
+  public:
+    Scope(GpuProfiler &profiler, Phase phase) : m_profiler(profiler), m_phase(phase) {
+      m_profiler.begin(m_phase);
+    }
+
+    ~Scope() {
+      m_profiler.end(m_phase);
+    }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+  private:
+    GpuProfiler &m_profiler;
+    Phase m_phase;
+  };
+
+  GpuProfiler();
+  ~GpuProfiler();
+
+  GpuProfiler(const GpuProfiler &) = delete;
+  GpuProfiler &operator=(const GpuProfiler &) = delete;
+
+  /// Returns false when the context has no timer queries, the profiler then measures nothing.
+  [[nodiscard]] bool isAvailable() const noexcept { return m_available; }
+
+  Phase addPhase(std::string name);
+  void begin(Phase phase);
+  void end(Phase phase);
+
+  /// Collects the frames whose results are ready and starts a new frame.
+  void endFrame();
+
+  [[nodiscard]] std::size_t getPhaseCount() const noexcept { return m_phases.size(); }
+  [[nodiscard]] const std::string &getName(Phase phase) const { return m_phases[phase].name; }
+  /// Returns the GPU time of the phase in milliseconds for the last HistorySize frames, oldest first from getHistoryOffset.
+  [[nodiscard]] const std::array<float, HistorySize> &getHistory(Phase phase) const { return m_phases[phase].history; }
+  [[nodiscard]] std::size_t getHistoryOffset() const noexcept { return m_historyOffset; }
+  [[nodiscard]] float getAverage(Phase phase) const;
+  /// Returns the GPU time of the phase in milliseconds in the most recent frame read back.
+  [[nodiscard]] float getLatest(Phase phase) const {
+    return m_phases[phase].history[(m_historyOffset + HistorySize - 1) % HistorySize];
+  }
+  /// Returns the number of frames read back so far, it tells when getLatest has a new value.
+  [[nodiscard]] std::size_t getCollectedFrames() const noexcept { return m_collectedFrames; }
+  /// Returns the number of frames that were not ready when their queries were reused.
+  [[nodiscard]] int getDroppedFrames() const noexcept { return m_dropped; }
+
+private:
+  struct Range {
+    Phase phase;
+    GLuint begin;
+    GLuint end;
+  };
+
+  struct Frame {
+    std::vector<GLuint> queries;
+    std::vector<Range> ranges;
+    std::size_t usedQueries{0};
+  };
+
+  struct PhaseInfo {
+    std::string name;
+    std::array<float, HistorySize> history{};
+    // index of the open range of this frame, -1 when the phase is not being measured
+    int openRange{-1};
+  };
+
+  GLuint nextQuery(Frame &frame);
+  void collect(Frame &frame);
+
+private:
+  bool m_available;
+  std::array<Frame, FramesInFlight> m_frames{};
+  std::size_t m_frame{0};
+  std::vector<PhaseInfo> m_phases;
+  std::size_t m_historyOffset{0};
+  std::size_t m_collectedFrames{0};
+  int m_dropped{0};
+};
@@ -0,0 +1,73 @@
+#include "MappedFile.h"
+#include <sstream>
+#include <stdexcept>
+#ifdef _WIN32
+#include <fstream>
+#include <iterator>
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    std::ostringstream ss;
+    ss << "Unable to open " << path;
+    throw std::runtime_error(ss.str());
+  }
+  m_buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  m_data = m_buffer.data();
+  m_size = m_buffer.size();
+}
+
+MappedFile::~MappedFile() = default;
+
+void MappedFile::advise(Access) {
+}
+#else
+MappedFile::MappedFile(const std::string &path) {
+  auto fd = ::open(path.c_str(), O_RDONLY);
+  struct stat info {};
+  if (fd == -1 || ::fstat(fd, &info) == -1) {
+    std::ostringstream ss;
+    ss << "Unable to open " << path << ": " << std::strerror(errno);
+    if (fd != -1) {
+      ::close(fd);
+    }
+    throw std::runtime_error(ss.str());
+  }
+
+  m_size = static_cast<std::size_t>(info.st_size);
+  // an empty file cannot be mapped, it is a view of no bytes
+  if (m_size > 0) {
+    auto data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      std::ostringstream ss;
+      ss << "Unable to map " << path << ": " << std::strerror(errno);
+      ::close(fd);
+      throw std::runtime_error(ss.str());
+    }
+    m_data = static_cast<const std::uint8_t *>(data);
+  }
+  // the mapping keeps the file alive
+  ::close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (m_data) {
+    ::munmap(const_cast<std::uint8_t *>(m_data), m_size);
+  }
+}
+
+void MappedFile::advise(Access access) {
+  if (m_data) {
+    ::madvise(const_cast<std::uint8_t *>(m_data), m_size, access == Access::Sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+  }
+}
+#endif
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// Read-only view of a whole file.
+///
+/// On POSIX systems the file is mapped in memory: opening it reads nothing, the pages are loaded on first access
+/// and shared with the page cache, so jumping to the end of a large file costs only the pages touched.
+/// Elsewhere the file is read into memory.
+class MappedFile {
+public:
+  /// Access pattern hint for the kernel.
+  enum class Access {
+    Sequential,
+    Random,
+  };
+
+  /// \param path: Specifies the file to map, an exception is thrown when it cannot be opened.
+  explicit MappedFile(const std::string &path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  /// Tells how the pages will be read: read-ahead helps sequential playback and wastes I/O when seeking.
+  void advise(Access access);
+
+  [[nodiscard]] const std::uint8_t *data() const noexcept { return m_data; }
+  [[nodiscard]] std::size_t size() const noexcept { return m_size; }
+
+private:
+  const std::uint8_t *m_data{nullptr};
+  std::size_t m_size{0};
+#ifdef _WIN32
+  std::vector<std::uint8_t> m_buffer;
+#endif
+};
@@ -0,0 +1,292 @@
+#include "PaletteExpander.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+// the x86 kernels are compiled for their instruction set with target attributes and picked at runtime,
+// the rest of the program keeps the baseline flags
+#define PALETTE_EXPANDER_X86
+#include <immintrin.h>
+#endif
+#if defined(__aarch64__) && defined(__ARM_NEON)
+// NEON is part of AArch64, tbl looks up 64 bytes in one instruction there
+#define PALETTE_EXPANDER_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+// pixels expanded at once by the upscaling path before they are replicated to the destination rows
+constexpr std::size_t ChunkSize = 256;
+
+// a constant factor lets the compiler unroll the copies into plain (or vector) stores
+template<int Scale>
+void replicate(const std::uint32_t *pixels, std::uint32_t *out, std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i) {
+    for (auto k = 0; k < Scale; ++k) {
+      out[i * Scale + k] = pixels[i];
+    }
+  }
+}
+
+#ifdef PALETTE_EXPANDER_X86
+// pshufb looks up 16 entries: each quarter of the table is looked up with the low 4 bits of the indices that fall
+// in it, the other indices are given bit 7, which makes pshufb write 0, and the quarters are or'ed together.
+// Only the quarters holding colors are looked up, the tables are read from memory (L1) so that few registers are used.
+__attribute__((target("ssse3"))) inline __m128i loadTable(const std::uint8_t *table) {
+  return _mm_load_si128(reinterpret_cast<const __m128i *>(table));
+}
+
+// vpshufb looks up within each 128-bit lane, both lanes hold the same quarter of the table
+__attribute__((target("avx2"))) inline __m256i broadcastTable(const std::uint8_t *table) {
+  return _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i *>(table)));
+}
+
+__attribute__((target("ssse3"))) std::size_t expandSsse3(const std::uint8_t (&tables)[3][64], int quarters,
+                                                         const std::uint8_t *src, std::uint8_t *dst, std::size_t count) {
+  const auto highMask = _mm_set1_epi8(static_cast<char>(0xF0));
+  const auto lowMask = _mm_set1_epi8(0x0F);
+  const auto zero = _mm_set1_epi8(static_cast<char>(0x80));
+  const auto alpha = _mm_set1_epi8(static_cast<char>(0xFF));
+
+  std::size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    const auto indices = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    const auto high = _mm_and_si128(indices, highMask);
+    const auto low = _mm_and_si128(indices, lowMask);
+    auto red = _mm_setzero_si128();
+    auto green = _mm_setzero_si128();
+    auto blue = _mm_setzero_si128();
+    for (auto quarter = 0; quarter < quarters; ++quarter) {
+      const auto selected = _mm_cmpeq_epi8(high, _mm_set1_epi8(static_cast<char>(quarter << 4)));
+      const auto index = _mm_or_si128(low, _mm_andnot_si128(selected, zero));
+      red = _mm_or_si128(red, _mm_shuffle_epi8(loadTable(tables[0] + quarter * 16), index));
+      green = _mm_or_si128(green, _mm_shuffle_epi8(loadTable(tables[1] + quarter * 16), index));
+      blue = _mm_or_si128(blue, _mm_shuffle_epi8(loadTable(tables[2] + quarter * 16), index));
+    }
+
+    // interleave the planes into RGBA pixels
+    const auto rgLow = _mm_unpacklo_epi8(red, green);
+    const auto rgHigh = _mm_unpackhi_epi8(red, green);
+    const auto baLow = _mm_unpacklo_epi8(blue, alpha);
+    const auto baHigh = _mm_unpackhi_epi8(blue, alpha);
+    auto out = reinterpret_cast<__m128i *>(dst + i * 4);
+    _mm_storeu_si128(out, _mm_unpacklo_epi16(rgLow, baLow));
+    _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(rgLow, baLow));
+    _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(rgHigh, baHigh));
+    _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(rgHigh, baHigh));
+  }
+  return i;
+}
+
+__attribute__((target("avx2"))) std::size_t expandAvx2(const std::uint8_t (&tables)[3][64], int quarters,
+                                                       const std::uint8_t *src, std::uint8_t *dst, std::size_t count) {
+  const auto highMask = _mm256_set1_epi8(static_cast<char>(0xF0));
+  const auto lowMask = _mm256_set1_epi8(0x0F);
+  const auto zero = _mm256_set1_epi8(static_cast<char>(0x80));
+  const auto alpha = _mm256_set1_epi8(static_cast<char>(0xFF));
+
+  std::size_t i = 0;
+  for (; i + 32 <= count; i += 32) {
+    const auto indices = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+    const auto high = _mm256_and_si256(indices, highMask);
+    const auto low = _mm256_and_si256(indices, lowMask);
+    auto red = _mm256_setzero_si256();
+    auto green = _mm256_setzero_si256();
+    auto blue = _mm256_setzero_si256();
+    for (auto quarter = 0; quarter < quarters; ++quarter) {
+      const auto selected = _mm256_cmpeq_epi8(high, _mm256_set1_epi8(static_cast<char>(quarter << 4)));
+      const auto index = _mm256_or_si256(low, _mm256_andnot_si256(selected, zero));
+      red = _mm256_or_si256(red, _mm256_shuffle_epi8(broadcastTable(tables[0] + quarter * 16), index));
+      green = _mm256_or_si256(green, _mm256_shuffle_epi8(broadcastTable(tables[1] + quarter * 16), index));
+      blue = _mm256_or_si256(blue, _mm256_shuffle_epi8(broadcastTable(tables[2] + quarter * 16), index));
+    }
+
+    // the unpacks work per lane: pixels 0-3 and 16-19 end up in the same register, and so on
+    const auto rgLow = _mm256_unpacklo_epi8(red, green);
+    const auto rgHigh = _mm256_unpackhi_epi8(red, green);
+    const auto baLow = _mm256_unpacklo_epi8(blue, alpha);
+    const auto baHigh = _mm256_unpackhi_epi8(blue, alpha);
+    const auto p0 = _mm256_unpacklo_epi16(rgLow, baLow);
+    const auto p1 = _mm256_unpackhi_epi16(rgLow, baLow);
+    const auto p2 = _mm256_unpacklo_epi16(rgHigh, baHigh);
+    const auto p3 = _mm256_unpackhi_epi16(rgHigh, baHigh);
+    auto out = reinterpret_cast<__m256i *>(dst + i * 4);
+    _mm256_storeu_si256(out, _mm256_permute2x128_si256(p0, p1, 0x20));
+    _mm256_storeu_si256(out + 1, _mm256_permute2x128_si256(p2, p3, 0x20));
+    _mm256_storeu_si256(out + 2, _mm256_permute2x128_si256(p0, p1, 0x31));
+    _mm256_storeu_si256(out + 3, _mm256_permute2x128_si256(p2, p3, 0x31));
+  }
+  return i;
+}
+#endif
+
+#ifdef PALETTE_EXPANDER_NEON
+std::size_t expandNeon(const std::uint8_t (&tables)[3][64], const std::uint8_t *src, std::uint8_t *dst, std::size_t count) {
+  uint8x16x4_t channels[3];
+  for (auto channel = 0; channel < 3; ++channel) {
+    for (auto quarter = 0; quarter < 4; ++quarter) {
+      channels[channel].val[quarter] = vld1q_u8(tables[channel] + quarter * 16);
+    }
+  }
+
+  std::size_t i = 0;
+  uint8x16x4_t pixels;
+  pixels.val[3] = vdupq_n_u8(0xFF);
+  for (; i + 16 <= count; i += 16) {
+    // tbl writes 0 for the indices of 64 and more
+    const auto indices = vld1q_u8(src + i);
+    pixels.val[0] = vqtbl4q_u8(channels[0], indices);
+    pixels.val[1] = vqtbl4q_u8(channels[1], indices);
+    pixels.val[2] = vqtbl4q_u8(channels[2], indices);
+    // the interleaving store writes the planes as RGBA pixels
+    vst4q_u8(dst + i * 4, pixels);
+  }
+  return i;
+}
+#endif
+}// namespace
+
+PaletteExpander::PaletteExpander(const std::uint8_t *palette, int numColors) : m_kernel(getBestKernel()) {
+  setPalette(palette, numColors);
+}
+
+void PaletteExpander::setPalette(const std::uint8_t *palette, int numColors) {
+  numColors = std::clamp(numColors, 0, static_cast<int>(m_colors.size()));
+  m_vectorizable = numColors <= MaxVectorColors;
+  m_quarters = std::max((numColors + 15) / 16, 1);
+
+  // RGBA32 is a byte order, copying the bytes keeps the table right on any endianness
+  const std::uint8_t black[4]{0, 0, 0, 0xFF};
+  std::uint32_t color;
+  std::memcpy(&color, black, sizeof(black));
+  m_colors.fill(color);
+  std::memset(m_tables, 0, sizeof(m_tables));
+  for (auto i = 0; i < numColors; ++i) {
+    const std::uint8_t rgba[4]{palette[i * 3], palette[i * 3 + 1], palette[i * 3 + 2], 0xFF};
+    std::memcpy(&m_colors[i], rgba, sizeof(rgba));
+    if (i < MaxVectorColors) {
+      m_tables[0][i] = rgba[0];
+      m_tables[1][i] = rgba[1];
+      m_tables[2][i] = rgba[2];
+    }
+  }
+}
+
+void PaletteExpander::setKernel(Kernel kernel) {
+  m_kernel = isSupported(kernel) ? kernel : Kernel::Scalar;
+}
+
+void PaletteExpander::expand(const std::uint8_t *src, std::uint8_t *dst, std::size_t count) const {
+  expandRow(src, dst, count);
+}
+
+void PaletteExpander::expand(const std::uint8_t *src, int width, int height, int scale, std::uint8_t *dst,
+                             std::size_t pitch) const {
+  if (scale <= 1) {
+    for (auto y = 0; y < height; ++y) {
+      expandRow(src + static_cast<std::size_t>(y) * width, dst + y * pitch, static_cast<std::size_t>(width));
+    }
+    return;
+  }
+
+  // the destination is only written: a texture being streamed to may be slow to read back
+  alignas(32) std::uint32_t pixels[ChunkSize];
+  for (auto y = 0; y < height; ++y) {
+    const auto srcRow = src + static_cast<std::size_t>(y) * width;
+    for (std::size_t x = 0; x < static_cast<std::size_t>(width); x += ChunkSize) {
+      const auto count = std::min(ChunkSize, static_cast<std::size_t>(width) - x);
+      expandRow(srcRow + x, reinterpret_cast<std::uint8_t *>(pixels), count);
+      for (auto row = 0; row < scale; ++row) {
+        auto out = reinterpret_cast<std::uint32_t *>(dst + (static_cast<std::size_t>(y) * scale + row) * pitch) + x * scale;
+        switch (scale) {
+        case 2:
+          replicate<2>(pixels, out, count);
+          break;
+        case 3:
+          replicate<3>(pixels, out, count);
+          break;
+        case 4:
+          replicate<4>(pixels, out, count);
+          break;
+        default:
+          for (std::size_t i = 0; i < count; ++i) {
+            std::fill_n(out + i * scale, scale, pixels[i]);
+          }
+          break;
+        }
+      }
+    }
+  }
+}
+
+void PaletteExpander::expandRow(const std::uint8_t *src, std::uint8_t *dst, std::size_t count) const {
+  std::size_t done = 0;
+  if (m_vectorizable) {
+    switch (m_kernel) {
+#ifdef PALETTE_EXPANDER_X86
+    case Kernel::Ssse3:
+      done = expandSsse3(m_tables, m_quarters, src, dst, count);
+      break;
+    case Kernel::Avx2:
+      done = expandAvx2(m_tables, m_quarters, src, dst, count);
+      break;
+#endif
+#ifdef PALETTE_EXPANDER_NEON
+    case Kernel::Neon:
+      done = expandNeon(m_tables, src, dst, count);
+      break;
+#endif
+    default:
+      break;
+    }
+  }
+
+  // the scalar kernel, and the tail of the vector ones
+  auto out = reinterpret_cast<std::uint32_t *>(dst);
+  for (auto i = done; i < count; ++i) {
+    out[i] = m_colors[src[i]];
+  }
+}
+
+bool PaletteExpander::isSupported(Kernel kernel) {
+  switch (kernel) {
+  case Kernel::Scalar:
+    return true;
+#ifdef PALETTE_EXPANDER_X86
+  case Kernel::Ssse3:
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("ssse3");
+  case Kernel::Avx2:
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+#ifdef PALETTE_EXPANDER_NEON
+  case Kernel::Neon:
+    return true;
+#endif
+  default:
+    return false;
+  }
+}
+
+PaletteExpander::Kernel PaletteExpander::getBestKernel() {
+  for (auto kernel : {Kernel::Avx2, Kernel::Neon, Kernel::Ssse3}) {
+    if (isSupported(kernel))
+      return kernel;
+  }
+  return Kernel::Scalar;
+}
+
+const char *PaletteExpander::getName(Kernel kernel) {
+  switch (kernel) {
+  case Kernel::Scalar:
+    return "scalar";
+  case Kernel::Ssse3:
+    return "SSSE3";
+  case Kernel::Avx2:
+    return "AVX2";
+  case Kernel::Neon:
+    return "NEON";
+  }
+  return "unknown";
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/// Maps images of palette indices to RGBA pixels (SDL_PIXELFORMAT_RGBA32 byte order) on the CPU.
+///
+/// Palettes of up to 64 colors are looked up 16 or 32 indices at a time with byte shuffles (pshufb on SSSE3/AVX2,
+/// tbl on NEON), larger ones go through a table of 32-bit colors. The kernel is picked at runtime from what the CPU supports.
+class PaletteExpander {
+public:
+  enum class Kernel {
+    Scalar,
+    Ssse3,
+    Avx2,
+    Neon,
+  };
+  /// Number of colors the vector kernels can look up.
+  static constexpr int MaxVectorColors = 64;
+
+  /// \param palette: Specifies the colors as RGB triplets.
+  /// \param numColors: Specifies the number of colors of the palette, at most 256.
+  PaletteExpander(const std::uint8_t *palette, int numColors);
+
+  /// Changes the colors, indices past the end of the palette are expanded to opaque black.
+  void setPalette(const std::uint8_t *palette, int numColors);
+
+  /// Expands a run of indices.
+  /// \param src: Specifies the palette indices.
+  /// \param dst: Specifies the RGBA pixels to write, count * 4 bytes.
+  /// \param count: Specifies the number of pixels.
+  void expand(const std::uint8_t *src, std::uint8_t *dst, std::size_t count) const;
+
+  /// Expands an image and upscales it by an integer factor (nearest neighbor) in the same pass,
+  /// each source row is expanded once and then replicated.
+  /// \param src: Specifies the palette indices, width * height bytes.
+  /// \param width: Specifies the width of the source image.
+  /// \param height: Specifies the height of the source image.
+  /// \param scale: Specifies the upscale factor, the destination is width * scale by height * scale pixels.
+  /// \param dst: Specifies the RGBA pixels to write.
+  /// \param pitch: Specifies the number of bytes between two rows of the destination.
+  void expand(const std::uint8_t *src, int width, int height, int scale, std::uint8_t *dst, std::size_t pitch) const;
+
+  /// Selects the kernel, it falls back to the scalar one when the CPU does not support it.
+  void setKernel(Kernel kernel);
+  /// Returns the selected kernel, the scalar one is used anyway while the palette has more than MaxVectorColors colors.
+  [[nodiscard]] Kernel getKernel() const noexcept { return m_kernel; }
+
+  [[nodiscard]] static bool isSupported(Kernel kernel);
+  /// Returns the fastest kernel supported by the CPU.
+  [[nodiscard]] static Kernel getBestKernel();
+  [[nodiscard]] static const char *getName(Kernel kernel);
+
+private:
+  void expandRow(const std::uint8_t *src, std::uint8_t *dst, std::size_t count) const;
+
+private:
+  Kernel m_kernel{Kernel::Scalar};
+  bool m_vectorizable{false};
+  // number of 16-entry quarters of the tables holding colors
+  int m_quarters{1};
+  // red, green and blue of the palette padded to 64 entries, read 16 entries at a time by the byte shuffles
+  alignas(16) std::uint8_t m_tables[3][MaxVectorColors]{};
+  // the palette as the bytes of a RGBA pixel, indexed by any byte
+  std::array<std::uint32_t, 256> m_colors{};
+};
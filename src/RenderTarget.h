@@ -1,7 +1,11 @@
 #pragma once
+#include <algorithm>
+#include <memory>
 #include "Debug.h"
+#include "GlCapabilities.h"
 #include "VertexBuffer.h"
 #include "Shader.h"
+#include "Texture.h"
 
 enum class PrimitiveType {
   Points,
@@ -22,15 +26,152 @@ enum class ElementType {
   UnsignedInt = GL_UNSIGNED_INT,
 };
 
+struct Viewport {
+  int x{0};
+  int y{0};
+  int width{0};
+  int height{0};
+};
+
 class RenderTarget {
 public:
+  /// Creates a render target drawing to the default framebuffer.
+  RenderTarget() = default;
+
+  /// Creates an offscreen render target backed by a framebuffer object with a color texture.
+  /// \param width: Specifies the width in pixels of the color buffer.
+  /// \param height: Specifies the height in pixels of the color buffer.
+  /// \param format: Specifies the format of the color texture, Index targets are written with an uint output.
+  RenderTarget(int width, int height, Texture::Format format = Texture::Format::Rgba)
+      : m_texture(std::make_unique<Texture>(format, width, height, nullptr)),
+        m_width(width), m_height(height), m_dsa(GlCapabilities::get().directStateAccess) {
+    if (m_dsa) {
+      GL_CHECK(glCreateFramebuffers(1, &m_fbo));
+      GL_CHECK(glNamedFramebufferTexture(m_fbo, GL_COLOR_ATTACHMENT0, m_texture->getHandle(), 0));
+      checkStatus(glCheckNamedFramebufferStatus(m_fbo, GL_FRAMEBUFFER));
+      return;
+    }
+    GL_CHECK(glGenFramebuffers(1, &m_fbo));
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, m_fbo));
+    GL_CHECK(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_texture->getHandle(), 0));
+    checkStatus(glCheckFramebufferStatus(GL_FRAMEBUFFER));
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+  }
+
+  /// Creates a render target drawing to a framebuffer owned by someone else, like the one of a headless window.
+  RenderTarget(unsigned int framebuffer, int width, int height)
+      : m_width(width), m_height(height), m_dsa(GlCapabilities::get().directStateAccess), m_fbo(framebuffer) {
+  }
+
+  ~RenderTarget() {
+    // only the framebuffers created with their color texture belong to the target
+    if (m_texture && m_fbo != 0) {
+      GL_CHECK(glDeleteFramebuffers(1, &m_fbo));
+    }
+  }
+
+  RenderTarget(const RenderTarget &) = delete;
+  RenderTarget &operator=(const RenderTarget &) = delete;
+
+  /// Makes this target the destination of the next draws and sets the viewport to its whole color buffer.
+  void bind() const {
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, m_fbo));
+    if (m_fbo != 0) {
+      GL_CHECK(glViewport(0, 0, m_width, m_height));
+    }
+  }
+
   void draw(const PrimitiveType primitiveType, const ElementType elementType, size_t size, const Shader *pShader) {
     if (pShader)
       Shader::bind(pShader);
     GL_CHECK(glDrawElements(getEnum(primitiveType), size, static_cast<GLenum>(elementType), nullptr));
   }
 
+  void drawInstanced(const PrimitiveType primitiveType, const ElementType elementType, size_t size, size_t instanceCount, const Shader *pShader) {
+    if (pShader)
+      Shader::bind(pShader);
+    GL_CHECK(glDrawElementsInstanced(getEnum(primitiveType), size, static_cast<GLenum>(elementType), nullptr, instanceCount));
+  }
+
+  void draw(const PrimitiveType primitiveType, int first, size_t count, const Shader *pShader) {
+    if (pShader)
+      Shader::bind(pShader);
+    GL_CHECK(glDrawArrays(getEnum(primitiveType), first, count));
+  }
+
+  /// Copies the color buffer of this offscreen target into a region of another framebuffer with nearest filtering.
+  /// \param dst: Specifies the destination region.
+  /// \param dstFramebuffer: Specifies the destination framebuffer, 0 for the default one.
+  void blit(const Viewport &dst, unsigned int dstFramebuffer = 0) const {
+    assert(m_fbo != 0);
+    if (m_dsa) {
+      GL_CHECK(glBlitNamedFramebuffer(m_fbo, dstFramebuffer, 0, 0, m_width, m_height,
+                                      dst.x, dst.y, dst.x + dst.width, dst.y + dst.height,
+                                      GL_COLOR_BUFFER_BIT, GL_NEAREST));
+      return;
+    }
+    GL_CHECK(glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo));
+    GL_CHECK(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, dstFramebuffer));
+    GL_CHECK(glBlitFramebuffer(0, 0, m_width, m_height,
+                               dst.x, dst.y, dst.x + dst.width, dst.y + dst.height,
+                               GL_COLOR_BUFFER_BIT, GL_NEAREST));
+    GL_CHECK(glBindFramebuffer(GL_READ_FRAMEBUFFER, 0));
+  }
+
+  [[nodiscard]] const Texture *getTexture() const noexcept {
+    return m_texture.get();
+  }
+
+  [[nodiscard]] Texture *getTexture() noexcept {
+    return m_texture.get();
+  }
+
+  /// Returns the framebuffer object, 0 for the default framebuffer.
+  [[nodiscard]] unsigned int getHandle() const noexcept {
+    return m_fbo;
+  }
+
+  /// Names the framebuffer and its color texture in debug messages.
+  void setLabel(const char *label) const {
+    labelObject(GL_FRAMEBUFFER, m_fbo, label);
+    if (m_texture) {
+      m_texture->setLabel(label);
+    }
+  }
+
+  [[nodiscard]] int getWidth() const noexcept {
+    return m_width;
+  }
+
+  [[nodiscard]] int getHeight() const noexcept {
+    return m_height;
+  }
+
+  /// Computes the centered region of a destination where an image keeps its aspect ratio.
+  /// \param integerScale: when true and the destination is large enough the image is scaled by a whole factor.
+  static Viewport letterbox(int srcWidth, int srcHeight, int dstWidth, int dstHeight, bool integerScale) {
+    int width, height;
+    auto scale = std::min(dstWidth / srcWidth, dstHeight / srcHeight);
+    if (integerScale && scale >= 1) {
+      width = srcWidth * scale;
+      height = srcHeight * scale;
+    } else if (dstWidth * srcHeight > srcWidth * dstHeight) {
+      height = dstHeight;
+      width = dstHeight * srcWidth / srcHeight;
+    } else {
+      width = dstWidth;
+      height = dstWidth * srcHeight / srcWidth;
+    }
+    return {(dstWidth - width) / 2, (dstHeight - height) / 2, width, height};
+  }
+
 private:
+  static void checkStatus(GLenum status) {
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+      std::cerr << "Framebuffer is not complete (status=0x" << std::hex << status << std::dec << ")\n";
+    }
+  }
+
   static GLenum getEnum(PrimitiveType type) {
     switch (type) {
     case PrimitiveType::Points:return GL_POINTS;
@@ -42,5 +183,13 @@ private:
     case PrimitiveType::Triangles:return GL_TRIANGLES;
     }
     assert(false);
+    return GL_TRIANGLES;
   }
-};
\ No newline at end of file
+
+private:
+  std::unique_ptr<Texture> m_texture{};
+  int m_width{0};
+  int m_height{0};
+  bool m_dsa{false};
+  unsigned int m_fbo{0};
+};
@@ -0,0 +1,43 @@
+#include "ResolutionController.h"
+
+ResolutionController::ResolutionController(float targetFrameTime)
+    : m_target(targetFrameTime) {
+}
+
+bool ResolutionController::update(float frameTime) {
+  if (m_settleFrames > 0) {
+    --m_settleFrames;
+    m_average = frameTime;
+    return false;
+  }
+
+  m_average += (frameTime - m_average) * Smoothing;
+  m_overFrames = m_average > m_target ? m_overFrames + 1 : 0;
+  // the cost grows with the number of pixels, the fixed part of it makes this prediction pessimistic
+  if (m_level > 0) {
+    auto ratio = Scales[m_level - 1] / Scales[m_level];
+    m_underFrames = m_average * ratio * ratio < m_target * RaiseRatio ? m_underFrames + 1 : 0;
+  }
+
+  auto level = m_level;
+  if (m_overFrames >= LowerFrames && m_level + 1 < Scales.size()) {
+    ++level;
+  } else if (m_underFrames >= RaiseFrames && m_level > 0) {
+    --level;
+  }
+  if (level == m_level)
+    return false;
+
+  m_level = level;
+  m_overFrames = 0;
+  m_underFrames = 0;
+  m_settleFrames = SettleFrames;
+  return true;
+}
+
+void ResolutionController::reset() {
+  m_level = 0;
+  m_overFrames = 0;
+  m_underFrames = 0;
+  m_settleFrames = SettleFrames;
+}
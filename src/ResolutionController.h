@@ -0,0 +1,42 @@
+#pragma once
+#include <array>
+#include <cstddef>
+
+/// Picks the resolution of the fire so that the measured cost of a frame stays under a target.
+///
+/// The cost is smoothed, it has to stay over the target for a while before the resolution is lowered.
+/// It is raised again only when the cost predicted for the higher resolution stays well under the target
+/// for longer. After a change the samples are ignored for a few frames, they were measured at the previous resolution.
+class ResolutionController {
+public:
+  static constexpr std::array<float, 5> Scales{1.f, 0.75f, 0.5f, 0.375f, 0.25f};
+
+  /// \param targetFrameTime: Specifies the cost in milliseconds a frame should stay under.
+  explicit ResolutionController(float targetFrameTime);
+
+  /// Feeds the measured cost of the last frame.
+  /// \return true when the scale has changed.
+  bool update(float frameTime);
+  /// Goes back to the full resolution.
+  void reset();
+
+  void setTargetFrameTime(float ms) noexcept { m_target = ms; }
+  [[nodiscard]] float getTargetFrameTime() const noexcept { return m_target; }
+  /// Returns the smoothed cost of a frame in milliseconds.
+  [[nodiscard]] float getFrameTime() const noexcept { return m_average; }
+  [[nodiscard]] float getScale() const noexcept { return Scales[m_level]; }
+
+private:
+  static constexpr float Smoothing = 0.1f;
+  static constexpr float RaiseRatio = 0.85f;
+  static constexpr int LowerFrames = 30;
+  static constexpr int RaiseFrames = 120;
+  static constexpr int SettleFrames = 30;
+
+  float m_target;
+  float m_average{0};
+  std::size_t m_level{0};
+  int m_overFrames{0};
+  int m_underFrames{0};
+  int m_settleFrames{0};
+};
@@ -1,13 +1,20 @@
 #pragma once
+#include <algorithm>
+#include <array>
 #include <cassert>
-#include <map>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <string_view>
 #include <vector>
 #include <GL/glew.h>
 #include <glm/vec2.hpp>
 #include <glm/mat4x4.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include "Debug.h"
+#include "ShaderCache.h"
 #include "Texture.h"
+#include "UniformBuffer.h"
 
 class Shader {
 public:
@@ -16,12 +23,27 @@ public:
     Fragment,
   };
 
+  /// Index of an active uniform in the table reflected at link time, -1 if the uniform is not active.
+  using UniformHandle = int;
+  static constexpr std::size_t MaxTextureUnits = 8;
+
   Shader(const char *vertexShader, const char *fragmentShader) {
     if (vertexShader == nullptr && fragmentShader == nullptr) {
       return;
     }
 
-    m_program = compile(vertexShader, fragmentShader);
+    // programs linked on a previous run are reloaded from their binary instead of being compiled again
+    auto &cache = ShaderCache::get();
+    const auto start = std::chrono::steady_clock::now();
+    m_program = cache.load(vertexShader, fragmentShader);
+    if (m_program != 0) {
+      cache.addLoadTime(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    } else {
+      m_program = compile(vertexShader, fragmentShader, cache.isEnabled());
+      cache.store(m_program, vertexShader, fragmentShader);
+      cache.addCompileTime(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    reflectUniforms();
   }
 
   ~Shader() {
@@ -34,6 +56,10 @@ public:
     return m_program;
   }
 
+  void setLabel(const char *label) const {
+    labelObject(GL_PROGRAM, m_program, label);
+  }
+
 private:
   struct Guard {
     explicit Guard(const Shader& shader)
@@ -60,10 +86,41 @@ private:
   };
 
 public:
+  /// Returns the handle of an active uniform, arrays can be looked up with or without the "[0]" suffix.
+  [[nodiscard]] UniformHandle getUniformHandle(std::string_view name) const {
+    if (name.size() > 3 && name.substr(name.size() - 3) == "[0]") {
+      name.remove_suffix(3);
+    }
+    for (std::size_t i = 0; i < m_uniforms.size(); ++i) {
+      if (m_uniforms[i].name == name)
+        return static_cast<UniformHandle>(i);
+    }
+    return -1;
+  }
+
+  void setUniform(UniformHandle handle, int value) const {
+    if (handle < 0)
+      return;
+    Guard guard(*this);
+    GL_CHECK(glUniform1i(m_uniforms[handle].location, value));
+  }
+
   void setUniform(std::string_view name, int value) const {
+    setUniform(getUniformHandle(name), value);
+  }
+
+  void setUniform(UniformHandle handle, float value) const {
+    if (handle < 0)
+      return;
+    Guard guard(*this);
+    GL_CHECK(glUniform1f(m_uniforms[handle].location, value));
+  }
+
+  void setUniform(UniformHandle handle, const glm::vec2 &value) const {
+    if (handle < 0)
+      return;
     Guard guard(*this);
-    auto loc = getUniformLocation(name);
-    GL_CHECK(glUniform1i(loc, value));
+    GL_CHECK(glUniform2f(m_uniforms[handle].location, value.x, value.y));
   }
 
   void setAttribute(std::string_view name, const glm::vec2 &value) const {
@@ -72,18 +129,35 @@ public:
     GL_CHECK(glVertexAttrib2f(loc, value.x, value.y));
   }
 
-  void setUniform(std::string_view name, const glm::mat4 &value) const {
+  void setUniform(UniformHandle handle, const glm::mat4 &value) const {
+    if (handle < 0)
+      return;
     Guard guard(*this);
-    auto loc = getUniformLocation(name);
-    GL_CHECK(glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(value)));
+    GL_CHECK(glUniformMatrix4fv(m_uniforms[handle].location, 1, GL_FALSE, glm::value_ptr(value)));
   }
 
-  void setUniform(std::string_view name, const Texture& tex) {
-    Guard guard(*this);
-    int loc = getUniformLocation(name);
-    if (loc == -1)
+  void setUniform(std::string_view name, const glm::mat4 &value) const {
+    setUniform(getUniformHandle(name), value);
+  }
+
+  /// Attaches a texture to a sampler uniform, the texture unit has been assigned at link time.
+  void setUniform(UniformHandle handle, const Texture &tex) {
+    if (handle < 0 || m_uniforms[handle].textureUnit < 0)
+      return;
+    m_textures[m_uniforms[handle].textureUnit] = &tex;
+  }
+
+  void setUniform(std::string_view name, const Texture &tex) {
+    setUniform(getUniformHandle(name), tex);
+  }
+
+  /// Associates a std140 uniform block with a binding point, the buffer is attached with UniformBuffer::bindBase.
+  void setUniformBlock(std::string_view name, unsigned int binding) const {
+    GLuint index;
+    GL_CHECK(index = glGetUniformBlockIndex(m_program, std::string(name).c_str()));
+    if (index == GL_INVALID_INDEX)
       return;
-    m_textures[loc] = &tex;
+    GL_CHECK(glUniformBlockBinding(m_program, index, binding));
   }
 
   static void bind(const Shader *shader) {
@@ -91,12 +165,11 @@ public:
       GL_CHECK(glUseProgram(static_cast<GLuint>(shader->m_program)));
 
       // bind textures
-      GLint index = 0;
-      for (auto &item : shader->m_textures) {
-        GL_CHECK(glActiveTexture(GL_TEXTURE0 + index));
-        GL_CHECK(glUniform1i(item.first, index));
-        item.second->bind();
-        index++;
+      for (std::size_t unit = 0; unit < shader->m_numTextureUnits; ++unit) {
+        auto texture = shader->m_textures[unit];
+        if (!texture)
+          continue;
+        texture->bind(static_cast<unsigned int>(unit));
       }
 
     } else {
@@ -111,10 +184,72 @@ public:
   }
 
 private:
-  [[nodiscard]] int getUniformLocation(std::string_view name) const {
-    GLint loc;
-    GL_CHECK(loc = glGetUniformLocation(static_cast<GLuint>(m_program), name.data()));
-    return loc;
+  struct Uniform {
+    std::string name;
+    GLint location;
+    GLenum type;
+    GLint size;
+    int textureUnit;
+  };
+
+  void reflectUniforms() {
+    if (m_program == 0)
+      return;
+
+    Guard guard(*this);
+    GLint count = 0;
+    GL_CHECK(glGetProgramiv(m_program, GL_ACTIVE_UNIFORMS, &count));
+    GLint maxLength = 0;
+    GL_CHECK(glGetProgramiv(m_program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength));
+    std::vector<char> name(std::max(maxLength, 1));
+    m_uniforms.reserve(count);
+    for (GLint i = 0; i < count; ++i) {
+      GLint size = 0;
+      GLenum type = GL_NONE;
+      GLsizei length = 0;
+      GL_CHECK(glGetActiveUniform(m_program, i, static_cast<GLsizei>(name.size()), &length, &size, &type, name.data()));
+      GLint loc;
+      GL_CHECK(loc = glGetUniformLocation(m_program, name.data()));
+      // uniforms living in a block have no location, they are fed through a uniform buffer
+      if (loc == -1)
+        continue;
+
+      std::string_view uniformName(name.data(), length);
+      if (uniformName.size() > 3 && uniformName.substr(uniformName.size() - 3) == "[0]") {
+        uniformName.remove_suffix(3);
+      }
+
+      auto unit = -1;
+      if (isSampler(type)) {
+        if (m_numTextureUnits == MaxTextureUnits) {
+          std::cerr << "Error while linking program: more than " << MaxTextureUnits << " samplers\n";
+          // the destructor does not run when the constructor throws
+          GL_CHECK(glDeleteProgram(m_program));
+          m_program = 0;
+          throw std::runtime_error("Error while linking program");
+        }
+        unit = static_cast<int>(m_numTextureUnits++);
+        GL_CHECK(glUniform1i(loc, unit));
+      }
+      m_uniforms.push_back({std::string(uniformName), loc, type, size, unit});
+    }
+  }
+
+  static bool isSampler(GLenum type) {
+    switch (type) {
+    case GL_SAMPLER_1D:
+    case GL_SAMPLER_2D:
+    case GL_SAMPLER_3D:
+    case GL_SAMPLER_CUBE:
+    case GL_SAMPLER_2D_ARRAY:
+    case GL_INT_SAMPLER_1D:
+    case GL_INT_SAMPLER_2D:
+    case GL_INT_SAMPLER_2D_ARRAY:
+    case GL_UNSIGNED_INT_SAMPLER_1D:
+    case GL_UNSIGNED_INT_SAMPLER_2D:
+    case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:return true;
+    default:return false;
+    }
   }
 
   static GLuint compileShader(Type type, const char *source) {
@@ -141,7 +276,7 @@ private:
     return id;
   }
 
-  static GLuint compile(const char *vertexShaderCode, const char *fragmentShaderCode) {
+  static GLuint compile(const char *vertexShaderCode, const char *fragmentShaderCode, bool retrievable) {
     assert(vertexShaderCode != nullptr || fragmentShaderCode != nullptr);
 
     GLuint program;
@@ -159,6 +294,9 @@ private:
       GL_CHECK(glDeleteShader(id)); // the shader is still here because it is attached to the program
     }
 
+    if (retrievable) {
+      GL_CHECK(glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+    }
     GL_CHECK(glLinkProgram(program));
 
     GLint linkStatus = GL_FALSE;
@@ -181,5 +319,7 @@ private:
 
 private:
   unsigned m_program{0};
-  std::map<int, const Texture *> m_textures;
+  std::vector<Uniform> m_uniforms;
+  std::array<const Texture *, MaxTextureUnits> m_textures{};
+  std::size_t m_numTextureUnits{0};
 };
\ No newline at end of file
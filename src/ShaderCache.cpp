@@ -0,0 +1,129 @@
+#include "ShaderCache.h"
+#include "Debug.h"
+#include "GlCapabilities.h"
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+namespace {
+constexpr std::uint32_t Magic = 0x43534644;// "DFSC"
+constexpr std::uint32_t Version = 1;
+
+struct Header {
+  std::uint32_t magic;
+  std::uint32_t version;
+  std::uint64_t key;
+  std::uint32_t format;
+  std::uint32_t length;
+};
+
+// 64-bit FNV-1a, chained so that several strings can be hashed as one
+std::uint64_t hash(const char *text, std::uint64_t h = 0xcbf29ce484222325ull) {
+  if (text == nullptr)
+    text = "";
+  for (; *text; ++text) {
+    h ^= static_cast<unsigned char>(*text);
+    h *= 0x100000001b3ull;
+  }
+  // separator, so that ("ab", "c") and ("a", "bc") do not collide
+  h ^= 0xff;
+  h *= 0x100000001b3ull;
+  return h;
+}
+
+std::string getGlString(GLenum name) {
+  const GLubyte *value;
+  GL_CHECK(value = glGetString(name));
+  return value ? reinterpret_cast<const char *>(value) : "";
+}
+}// namespace
+
+ShaderCache &ShaderCache::get() {
+  static ShaderCache cache;
+  return cache;
+}
+
+void ShaderCache::setDirectory(std::string directory) {
+  if (!GlCapabilities::get().programBinary) {
+    std::cout << "Shader cache disabled: program binaries are not supported\n";
+    return;
+  }
+  m_directory = std::move(directory);
+  m_driver = getGlString(GL_VENDOR) + '\n' + getGlString(GL_RENDERER) + '\n' + getGlString(GL_VERSION);
+}
+
+GLuint ShaderCache::load(const char *vertexShader, const char *fragmentShader) const {
+  if (!isEnabled())
+    return 0;
+
+  const auto key = getKey(vertexShader, fragmentShader);
+  std::ifstream file(getPath(key), std::ios::binary);
+  if (!file)
+    return 0;
+
+  Header header{};
+  if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) || header.magic != Magic
+      || header.version != Version || header.key != key || header.length == 0)
+    return 0;
+
+  std::vector<char> binary(header.length);
+  if (!file.read(binary.data(), static_cast<std::streamsize>(binary.size())))
+    return 0;
+
+  GLuint program;
+  GL_CHECK(program = glCreateProgram());
+  // a driver update can reject a binary with a matching key, it is reported through the link status
+  glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+  glGetError();
+  GLint linkStatus = GL_FALSE;
+  GL_CHECK(glGetProgramiv(program, GL_LINK_STATUS, &linkStatus));
+  if (linkStatus == GL_FALSE) {
+    GL_CHECK(glDeleteProgram(program));
+    return 0;
+  }
+  return program;
+}
+
+void ShaderCache::store(GLuint program, const char *vertexShader, const char *fragmentShader) const {
+  if (!isEnabled() || program == 0)
+    return;
+
+  GLint length = 0;
+  GL_CHECK(glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length));
+  if (length <= 0)
+    return;
+
+  std::vector<char> binary(length);
+  GLenum format = GL_NONE;
+  GL_CHECK(glGetProgramBinary(program, length, &length, &format, binary.data()));
+
+  const auto key = getKey(vertexShader, fragmentShader);
+  const Header header{Magic, Version, key, format, static_cast<std::uint32_t>(length)};
+
+  // write next to the final file then rename it, so that a crash never leaves a truncated binary
+  const auto path = getPath(key);
+  const auto tmpPath = path + ".tmp";
+  {
+    std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!file)
+      return;
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(binary.data(), length);
+    if (!file)
+      return;
+  }
+  std::remove(path.c_str());
+  if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+    std::remove(tmpPath.c_str());
+  }
+}
+
+std::uint64_t ShaderCache::getKey(const char *vertexShader, const char *fragmentShader) const {
+  return hash(m_driver.c_str(), hash(fragmentShader, hash(vertexShader)));
+}
+
+std::string ShaderCache::getPath(std::uint64_t key) const {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+  return m_directory + name;
+}
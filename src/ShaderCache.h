@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <GL/glew.h>
+
+/// Persists linked programs with glGetProgramBinary so the next launches can skip compiling and linking.
+///
+/// Binaries are keyed by a hash of the shader sources and of the GL vendor, renderer and version strings,
+/// any mismatch or a binary rejected by the driver falls back to compiling from source.
+class ShaderCache {
+public:
+  struct Stats {
+    int hits{0};
+    int misses{0};
+    /// Time spent creating programs from a cached binary, in milliseconds.
+    double loadTime{0};
+    /// Time spent compiling and linking programs from source, in milliseconds.
+    double compileTime{0};
+  };
+
+  static ShaderCache &get();
+
+  /// Enables the cache, binaries are stored in the given directory which must end with a path separator.
+  /// It has to be called once the context exists, the cache stays disabled if the driver has no binary format.
+  void setDirectory(std::string directory);
+
+  [[nodiscard]] bool isEnabled() const noexcept { return !m_directory.empty(); }
+
+  /// Creates a program from the binary cached for these sources.
+  /// \return the linked program or 0 if there is no usable binary.
+  GLuint load(const char *vertexShader, const char *fragmentShader) const;
+
+  /// Saves the binary of a program freshly linked from these sources.
+  void store(GLuint program, const char *vertexShader, const char *fragmentShader) const;
+
+  void addLoadTime(double ms) noexcept { ++m_stats.hits; m_stats.loadTime += ms; }
+  void addCompileTime(double ms) noexcept { ++m_stats.misses; m_stats.compileTime += ms; }
+  [[nodiscard]] const Stats &getStats() const noexcept { return m_stats; }
+
+private:
+  [[nodiscard]] std::uint64_t getKey(const char *vertexShader, const char *fragmentShader) const;
+  [[nodiscard]] std::string getPath(std::uint64_t key) const;
+
+private:
+  std::string m_directory;
+  std::string m_driver;
+  Stats m_stats;
+};
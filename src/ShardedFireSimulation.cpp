@@ -0,0 +1,439 @@
+#include "ShardedFireSimulation.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#if defined(__unix__) || defined(__APPLE__)
+#define SHARDED_FIRE_POSIX
+#include <cerrno>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#ifdef SHARDED_FIRE_POSIX
+namespace {
+// above the intensities, marks the halo pixels no spread reached
+constexpr std::uint8_t Unwritten = 0xFF;
+constexpr char TickCommand = 'T';
+constexpr char ResetCommand = 'R';
+constexpr char QuitCommand = 'Q';
+
+struct TickReport {
+  double sweepTime;
+  double exchangeTime;
+};
+
+[[noreturn]] void throwError(const char *what) {
+  std::ostringstream ss;
+  ss << what << ": " << std::strerror(errno);
+  throw std::runtime_error(ss.str());
+}
+
+bool sendAll(int fd, const void *data, std::size_t size) {
+  auto bytes = static_cast<const char *>(data);
+  while (size > 0) {
+#ifdef MSG_NOSIGNAL
+    // a stopped peer fails the call instead of raising SIGPIPE
+    auto sent = ::send(fd, bytes, size, MSG_NOSIGNAL);
+#else
+    auto sent = ::send(fd, bytes, size, 0);
+#endif
+    if (sent < 0 && errno == EINTR)
+      continue;
+    if (sent <= 0)
+      return false;
+    bytes += sent;
+    size -= static_cast<std::size_t>(sent);
+  }
+  return true;
+}
+
+bool receiveAll(int fd, void *data, std::size_t size) {
+  auto bytes = static_cast<char *>(data);
+  while (size > 0) {
+    auto received = ::recv(fd, bytes, size, 0);
+    if (received < 0 && errno == EINTR)
+      continue;
+    if (received <= 0)
+      return false;
+    bytes += received;
+    size -= static_cast<std::size_t>(received);
+  }
+  return true;
+}
+
+double getMilliseconds(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+/// The columns of a shard with a halo column on each side, stored column by column.
+class FireShard {
+public:
+  FireShard(const std::uint8_t *image, int imageWidth, int x, int width, int height, bool first, bool last,
+            std::uint32_t seed)
+      : m_x(x), m_width(width), m_height(height), m_first(first), m_last(last),
+        m_random(seed != 0 ? seed : FireSimulation::DefaultSeed),
+        m_columns(static_cast<std::size_t>(width + 2) * height), m_written(static_cast<std::size_t>(height) * 2),
+        m_sources(static_cast<std::size_t>(height) * 2, Unwritten) {
+    for (auto c = 0; c < width; ++c) {
+      auto column = getColumn(c + 1);
+      for (auto y = 0; y < height; ++y) {
+        column[y] = image[static_cast<std::size_t>(y) * imageWidth + x + c];
+      }
+    }
+  }
+
+  [[nodiscard]] int getWidth() const noexcept { return m_width; }
+  [[nodiscard]] int getHeight() const noexcept { return m_height; }
+  [[nodiscard]] std::uint8_t *getColumn(int c) noexcept { return m_columns.data() + static_cast<std::size_t>(c) * m_height; }
+
+  /// Clears the columns and lights the bottom row, as FireSimulation::reset().
+  void reset() {
+    for (auto c = 1; c <= m_width; ++c) {
+      auto column = getColumn(c);
+      std::fill_n(column, m_height - 1, 0);
+      column[m_height - 1] = FireSimulation::MaxIntensity;
+    }
+    std::fill(m_sources.begin(), m_sources.end(), Unwritten);
+  }
+
+  /// The sweep of FireSimulation::update(), the spreads out of the shard land in the halo columns.
+  void sweep() {
+    std::fill_n(getColumn(0), m_height, Unwritten);
+    std::fill_n(getColumn(m_width + 1), m_height, Unwritten);
+    std::fill(m_written.begin(), m_written.end(), 0);
+    for (auto c = 1; c <= m_width; ++c) {
+      auto column = getColumn(c);
+      // only the columns spreading into an edge one keep track of what they wrote
+      const auto edge = c <= 2 || c >= m_width - 1;
+      const auto sources = c == 1 && !m_first ? m_sources.data() : c == m_width && m_last ? m_sources.data() + m_height
+                                                                                          : nullptr;
+      for (auto y = 1; y < m_height; ++y) {
+        auto pixel = column[y];
+        if (sources && sources[y] != Unwritten) {
+          pixel = sources[y];
+        }
+        auto target = c;
+        if (pixel == 0) {
+          column[y - 1] = 0;
+        } else {
+          auto randIdx = static_cast<int>((static_cast<std::uint64_t>(nextRandom()) * 3) >> 32);
+          // 0 spreads to the right column, 2 to the left one
+          target = c + 1 - randIdx;
+          column[y - 1 + (1 - randIdx) * m_height] = static_cast<std::uint8_t>(pixel - (randIdx & 1));
+        }
+        if (edge) {
+          markWritten(target, y - 1);
+        }
+      }
+    }
+
+    // FireSimulation clamps the left spread of the first pixel of the second row to the first pixel of the image,
+    // before the second column of the image spreads there
+    auto halo = getColumn(0);
+    if (m_first && halo[0] != Unwritten && !m_written[0]) {
+      getColumn(1)[0] = halo[0];
+    }
+  }
+
+  /// Applies the spreads of the shard on the left into the first column.
+  /// In FireSimulation they happen before the column sweeps: the spreads of this shard win, and the sweep reads the
+  /// ones of its neighbor. A shard only gets them once it swept, the next sweep reads them instead. The spreads out of
+  /// the right edge of the image, which the first shard receives, wrap to the row below of the first column after
+  /// every other spread.
+  void mergeLeft(const std::uint8_t *halo) {
+    auto column = getColumn(1);
+    if (m_first) {
+      for (auto y = 0; y < m_height - 1; ++y) {
+        if (halo[y] != Unwritten) {
+          column[y + 1] = halo[y];
+        }
+      }
+      return;
+    }
+    std::copy_n(halo, m_height, m_sources.data());
+    for (auto y = 0; y < m_height; ++y) {
+      if (halo[y] != Unwritten && !m_written[static_cast<std::size_t>(y)]) {
+        column[y] = halo[y];
+      }
+    }
+  }
+
+  /// Applies the spreads of the shard on the right into the last column.
+  /// In FireSimulation they happen after the column swept, so they win. The spreads out of the left edge of the
+  /// image, which the last shard receives, wrap two rows up in the last column before its sweep, as the ones of a
+  /// shard on the left.
+  void mergeRight(const std::uint8_t *halo) {
+    auto column = getColumn(m_width);
+    if (m_last) {
+      auto sources = m_sources.data() + m_height;
+      // the first row was clamped by the first shard
+      for (auto y = 1; y < m_height; ++y) {
+        sources[y - 1] = halo[y];
+        if (halo[y] != Unwritten && !m_written[static_cast<std::size_t>(m_height + y - 1)]) {
+          column[y - 1] = halo[y];
+        }
+      }
+      return;
+    }
+    for (auto y = 0; y < m_height; ++y) {
+      if (halo[y] != Unwritten) {
+        column[y] = halo[y];
+      }
+    }
+  }
+
+  void store(std::uint8_t *image, int imageWidth) {
+    for (auto y = 0; y < m_height; ++y) {
+      auto row = image + static_cast<std::size_t>(y) * imageWidth + m_x;
+      auto src = m_columns.data() + m_height + y;
+      for (auto c = 0; c < m_width; ++c) {
+        row[c] = src[static_cast<std::size_t>(c) * m_height];
+      }
+    }
+  }
+
+private:
+  void markWritten(int c, int y) noexcept {
+    if (c == 1) {
+      m_written[static_cast<std::size_t>(y)] = 1;
+    }
+    if (c == m_width) {
+      m_written[static_cast<std::size_t>(m_height + y)] = 1;
+    }
+  }
+
+  std::uint32_t nextRandom() noexcept {
+    m_random ^= m_random << 13;
+    m_random ^= m_random >> 17;
+    m_random ^= m_random << 5;
+    return m_random;
+  }
+
+private:
+  int m_x;
+  int m_width;
+  int m_height;
+  bool m_first;
+  bool m_last;
+  std::uint32_t m_random;
+  std::vector<std::uint8_t> m_columns;
+  // cells of the first then of the last column written by the sweep of this tick
+  std::vector<std::uint8_t> m_written;
+  // spreads of the neighbors the next sweep reads in the first then in the last column
+  std::vector<std::uint8_t> m_sources;
+};
+
+/// Body of a shard process: one command at a time until the coordinator quits or a peer stops.
+[[noreturn]] void runShard(FireShard &shard, int control, int left, int right, std::uint8_t *image, int imageWidth) {
+  const auto height = static_cast<std::size_t>(shard.getHeight());
+  std::vector<std::uint8_t> halo(height);
+  char command;
+  while (receiveAll(control, &command, 1)) {
+    if (command == ResetCommand) {
+      shard.reset();
+      shard.store(image, imageWidth);
+      if (!sendAll(control, &command, 1))
+        break;
+      continue;
+    }
+    if (command != TickCommand)
+      break;
+
+    const auto start = std::chrono::steady_clock::now();
+    shard.sweep();
+    const auto swept = std::chrono::steady_clock::now();
+
+    // both neighbors send before receiving, the socket buffers hold a halo
+    auto ok = sendAll(left, shard.getColumn(0), height) && sendAll(right, shard.getColumn(shard.getWidth() + 1), height);
+    if (ok) {
+      ok = receiveAll(left, halo.data(), height);
+      shard.mergeLeft(halo.data());
+    }
+    if (ok) {
+      ok = receiveAll(right, halo.data(), height);
+      shard.mergeRight(halo.data());
+    }
+    const auto exchanged = std::chrono::steady_clock::now();
+    if (!ok)
+      break;
+
+    shard.store(image, imageWidth);
+    TickReport report{getMilliseconds(start, swept), getMilliseconds(swept, exchanged)};
+    if (!sendAll(control, &report, sizeof(report)))
+      break;
+  }
+  // the destructors belong to the coordinator: its windows, threads and files
+  ::_exit(0);
+}
+}// namespace
+
+ShardedFireSimulation::ShardedFireSimulation(const std::uint8_t *image, int width, int height, int shardCount,
+                                             std::uint32_t seed)
+    : m_width(width), m_height(height) {
+  shardCount = std::clamp(shardCount, 1, width);
+  m_imageSize = static_cast<std::size_t>(width) * height;
+  auto data = ::mmap(nullptr, m_imageSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (data == MAP_FAILED)
+    throwError("Unable to map the frame of the fire shards");
+  m_image = static_cast<std::uint8_t *>(data);
+  std::memcpy(m_image, image, m_imageSize);
+
+  // [0] stays in the coordinator for the control pairs, in the shard on the left for the halo pairs: the last one
+  // links the last shard to the first, the image wraps from one edge to the other
+  std::vector<std::array<int, 2>> controls(static_cast<std::size_t>(shardCount), {-1, -1});
+  std::vector<std::array<int, 2>> halos(static_cast<std::size_t>(shardCount), {-1, -1});
+  auto closePairs = [&](bool coordinatorEnds) {
+    for (auto &pair : controls) {
+      if (coordinatorEnds && pair[0] != -1) {
+        ::close(pair[0]);
+      }
+      if (pair[1] != -1) {
+        ::close(pair[1]);
+      }
+    }
+    for (auto &pair : halos) {
+      for (auto fd : pair) {
+        if (fd != -1) {
+          ::close(fd);
+        }
+      }
+    }
+  };
+  auto fail = [&](const char *what) {
+    const auto error = errno;
+    closePairs(true);
+    // the shards already started see their control pair closed and quit
+    for (auto &shard : m_shards) {
+      shard.control = -1;
+    }
+    stop();
+    ::munmap(m_image, m_imageSize);
+    errno = error;
+    throwError(what);
+  };
+
+  for (auto &pair : controls) {
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, pair.data()) == -1)
+      fail("Unable to create the sockets of the fire shards");
+  }
+  for (auto &pair : halos) {
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, pair.data()) == -1)
+      fail("Unable to create the sockets of the fire shards");
+    // a halo has to fit in the buffer, the neighbors send theirs before receiving
+    int bufferSize = std::max(height * 2, 64 * 1024);
+    for (auto fd : pair) {
+      ::setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+    }
+  }
+
+  for (auto i = 0; i < shardCount; ++i) {
+    const auto x = static_cast<int>(static_cast<std::int64_t>(i) * width / shardCount);
+    const auto shardWidth = static_cast<int>(static_cast<std::int64_t>(i + 1) * width / shardCount) - x;
+    const auto pid = ::fork();
+    if (pid == -1)
+      fail("Unable to start the fire shards");
+    if (pid == 0) {
+      const auto index = static_cast<std::size_t>(i);
+      const auto control = controls[index][1];
+      const auto left = halos[(index + halos.size() - 1) % halos.size()][1];
+      const auto right = halos[index][0];
+      // the other ends would keep the peers of a stopped process waiting
+      for (auto &pair : controls) {
+        for (auto fd : pair) {
+          if (fd != control) {
+            ::close(fd);
+          }
+        }
+      }
+      for (auto &pair : halos) {
+        for (auto fd : pair) {
+          if (fd != left && fd != right) {
+            ::close(fd);
+          }
+        }
+      }
+      FireShard shard(m_image, width, x, shardWidth, height, i == 0, i == shardCount - 1,
+                      seed * static_cast<std::uint32_t>(i + 1));
+      runShard(shard, control, left, right, m_image, width);
+    }
+    m_shards.push_back({pid, controls[static_cast<std::size_t>(i)][0], x, shardWidth});
+  }
+  closePairs(false);
+}
+
+ShardedFireSimulation::~ShardedFireSimulation() {
+  stop();
+  ::munmap(m_image, m_imageSize);
+}
+
+void ShardedFireSimulation::update() {
+  const auto start = std::chrono::steady_clock::now();
+  for (const auto &shard : m_shards) {
+    if (!sendAll(shard.control, &TickCommand, 1))
+      throw std::runtime_error("A fire shard stopped");
+  }
+  double sweepTime = 0;
+  double exchangeTime = 0;
+  for (const auto &shard : m_shards) {
+    TickReport report{};
+    if (!receiveAll(shard.control, &report, sizeof(report)))
+      throw std::runtime_error("A fire shard stopped");
+    sweepTime = std::max(sweepTime, report.sweepTime);
+    exchangeTime = std::max(exchangeTime, report.exchangeTime);
+  }
+
+  m_stats.ticks++;
+  m_stats.tickTime += getMilliseconds(start, std::chrono::steady_clock::now());
+  m_stats.sweepTime += sweepTime;
+  m_stats.exchangeTime += exchangeTime;
+  m_stats.haloBytes += 2 * m_shards.size() * static_cast<std::size_t>(m_height);
+}
+
+void ShardedFireSimulation::reset() {
+  for (const auto &shard : m_shards) {
+    if (!sendAll(shard.control, &ResetCommand, 1))
+      throw std::runtime_error("A fire shard stopped");
+  }
+  for (const auto &shard : m_shards) {
+    char command;
+    if (!receiveAll(shard.control, &command, 1))
+      throw std::runtime_error("A fire shard stopped");
+  }
+}
+
+void ShardedFireSimulation::stop() {
+  for (auto &shard : m_shards) {
+    if (shard.control != -1) {
+      sendAll(shard.control, &QuitCommand, 1);
+      ::close(shard.control);
+      shard.control = -1;
+    }
+  }
+  for (const auto &shard : m_shards) {
+    while (::waitpid(shard.pid, nullptr, 0) == -1 && errno == EINTR) {
+    }
+  }
+  m_shards.clear();
+}
+#else
+ShardedFireSimulation::ShardedFireSimulation(const std::uint8_t *, int width, int height, int, std::uint32_t)
+    : m_width(width), m_height(height) {
+  throw std::runtime_error("The sharded fire needs fork and Unix domain sockets");
+}
+
+ShardedFireSimulation::~ShardedFireSimulation() = default;
+
+void ShardedFireSimulation::update() {
+}
+
+void ShardedFireSimulation::reset() {
+}
+
+void ShardedFireSimulation::stop() {
+}
+#endif
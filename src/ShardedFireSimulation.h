@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "FireSimulation.h"
+
+/// The CPU fire split into column slices simulated by child processes, for grids too wide for one core (video walls).
+///
+/// Each shard sweeps its columns as FireSimulation does, but stores them column by column: the sweep reads memory
+/// in order and the edge columns are contiguous. Pixels spreading across an edge land in a halo column that is sent
+/// to the neighboring shard after the sweep, over a Unix domain socket pair, and merged into its edge column in the
+/// order the single process sweep writes them; the shards form a ring, FireSimulation wraps the spreads out of the
+/// image to the other edge. The shards write their slice into a frame mapped shared before forking, the coordinator
+/// only starts the ticks and waits for them.
+/// The fire is not bit-exact with the single process one: that sweep runs from the left column to the right one
+/// with a single random sequence, and reads the spreads of the column on its left in the tick they are written where
+/// a shard only gets them after its sweep.
+///
+/// The shards only talk through file descriptors, sockets between hosts would fit the same protocol.
+class ShardedFireSimulation {
+public:
+  struct Stats {
+    std::uint64_t ticks{0};
+    /// Time the coordinator waited for the ticks, in milliseconds.
+    double tickTime{0};
+    /// Time of the slowest shard sweeping its columns, and waiting for the halos of its neighbors, summed over the
+    /// ticks in milliseconds: a large exchange time means unbalanced shards.
+    double sweepTime{0};
+    double exchangeTime{0};
+    /// Bytes of halo columns sent between the shards.
+    std::uint64_t haloBytes{0};
+  };
+
+  /// Forks the shard processes, as early as possible: a process with threads only duplicates the calling one.
+  /// \param image: Specifies the initial palette indices, width * height bytes, rows from top to bottom.
+  /// \param shardCount: Specifies the number of processes, at most one per column.
+  /// \param seed: Specifies the seed of the random generators, each shard derives its own.
+  ShardedFireSimulation(const std::uint8_t *image, int width, int height, int shardCount,
+                        std::uint32_t seed = FireSimulation::DefaultSeed);
+  /// Stops the shards and waits for them.
+  ~ShardedFireSimulation();
+
+  ShardedFireSimulation(const ShardedFireSimulation &) = delete;
+  ShardedFireSimulation &operator=(const ShardedFireSimulation &) = delete;
+
+  /// Advances every shard by one tick and waits for them, an exception is thrown when a shard stopped.
+  void update();
+  /// Clears the image and lights the bottom row, as FireSimulation::reset().
+  void reset();
+
+  [[nodiscard]] int getWidth() const noexcept { return m_width; }
+  [[nodiscard]] int getHeight() const noexcept { return m_height; }
+  [[nodiscard]] int getShardCount() const noexcept { return static_cast<int>(m_shards.size()); }
+  /// Returns the frame the shards write to, complete between two calls to update().
+  [[nodiscard]] const std::uint8_t *getImage() const noexcept { return m_image; }
+  [[nodiscard]] const Stats &getStats() const noexcept { return m_stats; }
+
+private:
+  struct Shard {
+    int pid{-1};
+    /// Coordinator end of the socket pair the ticks are started and reported on.
+    int control{-1};
+    int x{0};
+    int width{0};
+  };
+
+  void stop();
+
+private:
+  int m_width;
+  int m_height;
+  std::uint8_t *m_image{nullptr};
+  std::size_t m_imageSize{0};
+  std::vector<Shard> m_shards;
+  Stats m_stats;
+};
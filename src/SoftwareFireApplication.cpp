@@ -0,0 +1,199 @@
+#include "SoftwareFireApplication.h"
+#include "FirePalette.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+void SoftwareFireApplication::onInit() {
+  Application::onInit();
+  if (m_settings.fireWidth > 0 && m_settings.fireHeight > 0) {
+    m_fire.resize(m_settings.fireWidth, m_settings.fireHeight);
+  }
+  loadSnapshot(m_fire);
+  // forked before the outputs start their threads
+  if (m_settings.shards > 0) {
+    try {
+      m_shardedFire = std::make_unique<ShardedFireSimulation>(m_fire.getImage(), m_fire.getWidth(), m_fire.getHeight(),
+                                                              m_settings.shards);
+      std::cout << "Fire of " << m_fire.getWidth() << "x" << m_fire.getHeight() << " simulated by "
+                << m_shardedFire->getShardCount() << " processes\n";
+    } catch (const std::exception &e) {
+      std::cerr << e.what() << '\n';
+    }
+  }
+  m_presenter = std::make_unique<SoftwarePresenter>(m_window.getRenderer(), m_fire.getWidth(), m_fire.getHeight(),
+                                                    m_palette.data(), FirePalette::NumColors);
+  updateScale();
+  std::cout << "Palette expansion: " << PaletteExpander::getName(m_presenter->getExpander().getKernel()) << " kernel\n";
+  if (m_settings.terminal) {
+    m_terminal = std::make_unique<TerminalRenderer>(m_palette.data(), FirePalette::NumColors);
+  }
+  openOutputs(m_fire.getWidth(), m_fire.getHeight(), m_palette.data(), FirePalette::NumColors);
+  openPlayback();
+  m_titleStopWatch.restart();
+}
+
+void SoftwareFireApplication::onExit() {
+  if (m_terminal) {
+    // the messages go to the screen the terminal is back to
+    const auto stats = m_terminal->getStats();
+    m_terminal.reset();
+    const auto frames = static_cast<double>(std::max<std::uint64_t>(stats.frames, 1));
+    std::cout << "Terminal: " << stats.frames << " frames, " << static_cast<double>(stats.bytes) / frames / 1024.
+              << " KB/frame (" << static_cast<double>(stats.bytes) / frames * m_settings.terminalFps / 1024.
+              << " KB/s at " << m_settings.terminalFps << " fps), "
+              << 100. * static_cast<double>(stats.changedCells) / static_cast<double>(std::max<std::uint64_t>(stats.cells, 1))
+              << "% of the cells redrawn, " << stats.renderTime / frames << " ms/frame\n";
+  }
+  if (!m_settings.saveSnapshot.empty()) {
+    saveSnapshot(m_fire, m_settings.saveSnapshot);
+  }
+  // the frame time printed by Application::run compares with a run of the GL path, this is its breakdown
+  std::cout << "Software path: simulation "
+            << m_simulationTime.getTotalMilliseconds() / static_cast<float>(std::max(m_simulationTicks, 1))
+            << " ms/tick, expansion and copy "
+            << m_presentTime.getTotalMilliseconds() / static_cast<float>(std::max(m_presentedFrames, 1))
+            << " ms/frame\n";
+  if (m_shardedFire) {
+    const auto &stats = m_shardedFire->getStats();
+    const auto ticks = static_cast<double>(std::max<std::uint64_t>(stats.ticks, 1));
+    std::cout << "Shards: slowest sweep " << stats.sweepTime / ticks << " ms/tick, halo exchange "
+              << stats.exchangeTime / ticks << " ms/tick, " << static_cast<double>(stats.haloBytes) / 1e6
+              << " MB of halos\n";
+    m_shardedFire.reset();
+  }
+}
+
+void SoftwareFireApplication::onEvent(SDL_Event &event) {
+  switch (event.type) {
+  case SDL_WINDOWEVENT:
+    updateScale();
+    break;
+  case SDL_KEYDOWN:
+    if (event.key.keysym.scancode == SDL_SCANCODE_ESCAPE) {
+      m_done = true;
+    }
+    break;
+  case SDL_JOYBUTTONDOWN:
+    if (event.jbutton.button == 0) {
+      m_fire.reset();
+      if (m_shardedFire) {
+        try {
+          m_shardedFire->reset();
+        } catch (const std::exception &e) {
+          std::cerr << e.what() << ", the fire is simulated by this process from now on\n";
+          m_shardedFire.reset();
+        }
+      }
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+void SoftwareFireApplication::onUpdate(const TimeSpan &) {
+  StopWatch stopWatch;
+  if (m_player && seekPlayback(m_player->getFrame() + 1)) {
+    m_fire.setImage(m_player->getImage(), m_player->getWidth(), m_player->getHeight());
+  } else if (m_shardedFire) {
+    try {
+      m_shardedFire->update();
+      // the outputs read the fire of this process
+      m_fire.setImage(m_shardedFire->getImage(), m_shardedFire->getWidth(), m_shardedFire->getHeight());
+    } catch (const std::exception &e) {
+      std::cerr << e.what() << ", the fire is simulated by this process from now on\n";
+      m_shardedFire.reset();
+    }
+  } else {
+    m_fire.update();
+  }
+  const auto elapsed = stopWatch.getElapsedTime();
+  writeOutputs(m_fire.getImage(), m_fire.getWidth(), m_fire.getHeight());
+  m_simulationTime += elapsed;
+  m_titleSimulationTime += elapsed;
+  m_simulationTicks++;
+  m_titleTicks++;
+}
+
+void SoftwareFireApplication::onRender() {
+  if (m_terminal) {
+    presentTerminal();
+    return;
+  }
+
+  StopWatch stopWatch;
+  m_presenter->present(m_fire.getImage());
+  const auto elapsed = stopWatch.getElapsedTime();
+  m_presentTime += elapsed;
+  m_titlePresentTime += elapsed;
+  m_presentedFrames++;
+  m_titleFrames++;
+
+  if (m_titleStopWatch.getElapsedTime() >= TimeSpan::seconds(1)) {
+    updateTitle();
+  }
+
+  Application::onRender();
+}
+
+void SoftwareFireApplication::presentTerminal() {
+  const auto interval = TimeSpan::seconds(1.f / static_cast<float>(std::max(m_settings.terminalFps, 1)));
+  if (m_simulationTicks == m_terminalTick || m_terminalStopWatch.getElapsedTime() < interval) {
+    // nothing new to draw, the loop would keep a core of the server busy
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  } else {
+    m_terminalStopWatch.restart();
+    m_terminalTick = m_simulationTicks;
+    StopWatch stopWatch;
+    m_terminal->present(m_fire.getImage(), m_fire.getWidth(), m_fire.getHeight());
+    const auto elapsed = stopWatch.getElapsedTime();
+    m_presentTime += elapsed;
+    m_titlePresentTime += elapsed;
+    m_presentedFrames++;
+    m_titleFrames++;
+  }
+
+  if (m_titleStopWatch.getElapsedTime() >= TimeSpan::seconds(1)) {
+    updateTitle();
+  }
+  Application::onRender();
+}
+
+void SoftwareFireApplication::updateScale() {
+  auto renderer = m_window.getRenderer();
+  if (!renderer)
+    return;
+  // the largest integer upscale that fits is done while expanding, the renderer only scales the remainder
+  int width, height;
+  SDL_GetRendererOutputSize(renderer, &width, &height);
+  m_presenter->setScale(std::min(width / m_fire.getWidth(), height / m_fire.getHeight()));
+}
+
+void SoftwareFireApplication::updateTitle() {
+  auto window = m_window.getNativeHandle();
+  if (window || m_terminal) {
+    std::ostringstream ss;
+    ss.precision(3);
+    if (m_terminal) {
+      ss << "Doom Fire (terminal) - " << m_titleFrames << " fps, simulation "
+         << m_titleSimulationTime.getTotalMilliseconds() / static_cast<float>(std::max(m_titleTicks, 1))
+         << " ms, drawing " << m_titlePresentTime.getTotalMilliseconds() / static_cast<float>(std::max(m_titleFrames, 1))
+         << " ms";
+      m_terminal->setTitle(ss.str());
+    } else {
+      ss << "SDL Doom Fire (software) - " << m_fps << " fps, simulation "
+         << m_titleSimulationTime.getTotalMilliseconds() / static_cast<float>(std::max(m_titleTicks, 1))
+         << " ms, expansion and copy "
+         << m_titlePresentTime.getTotalMilliseconds() / static_cast<float>(std::max(m_titleFrames, 1)) << " ms";
+      SDL_SetWindowTitle(window, ss.str().c_str());
+    }
+  }
+  m_titleStopWatch.restart();
+  m_titleSimulationTime = TimeSpan::Zero;
+  m_titlePresentTime = TimeSpan::Zero;
+  m_titleTicks = 0;
+  m_titleFrames = 0;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <memory>
+#include "Application.h"
+#include "FireSimulation.h"
+#include "ShardedFireSimulation.h"
+#include "SoftwarePresenter.h"
+#include "StopWatch.h"
+#include "TerminalRenderer.h"
+
+/// The fire without OpenGL: the CPU simulation is presented through an SDL renderer,
+/// to run wherever SDL does and to compare the cost of a frame with the GL path.
+class SoftwareFireApplication final : public Application {
+public:
+  using Application::Application;
+
+protected:
+  void onInit() override;
+  void onExit() override;
+  void onEvent(SDL_Event &event) override;
+  void onUpdate(const TimeSpan &elapsed) override;
+  void onRender() override;
+
+private:
+  void presentTerminal();
+  void updateScale();
+  void updateTitle();
+
+private:
+  static constexpr int FIRE_WIDTH = 640;
+  static constexpr int FIRE_HEIGHT = 480;
+
+  FireSimulation m_fire{FIRE_WIDTH, FIRE_HEIGHT};
+  std::unique_ptr<ShardedFireSimulation> m_shardedFire;
+  std::unique_ptr<SoftwarePresenter> m_presenter;
+  std::unique_ptr<TerminalRenderer> m_terminal;
+  StopWatch m_terminalStopWatch;
+  // tick of the last frame drawn in the terminal, a tick is drawn once
+  int m_terminalTick{-1};
+  // CPU time spent in each phase since the start, and over the last second for the title
+  TimeSpan m_simulationTime{TimeSpan::Zero};
+  TimeSpan m_presentTime{TimeSpan::Zero};
+  int m_simulationTicks{0};
+  int m_presentedFrames{0};
+  StopWatch m_titleStopWatch;
+  TimeSpan m_titleSimulationTime{TimeSpan::Zero};
+  TimeSpan m_titlePresentTime{TimeSpan::Zero};
+  int m_titleTicks{0};
+  int m_titleFrames{0};
+};
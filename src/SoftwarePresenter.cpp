@@ -0,0 +1,80 @@
+#include "SoftwarePresenter.h"
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+SoftwarePresenter::SoftwarePresenter(SDL_Renderer *renderer, int width, int height, const std::uint8_t *palette, int numColors)
+    : m_renderer(renderer), m_width(width), m_height(height), m_expander(palette, numColors) {
+  createTexture();
+}
+
+SoftwarePresenter::~SoftwarePresenter() {
+  if (m_texture) {
+    SDL_DestroyTexture(m_texture);
+  }
+}
+
+void SoftwarePresenter::resize(int width, int height) {
+  if (width == m_width && height == m_height)
+    return;
+  m_width = width;
+  m_height = height;
+  createTexture();
+}
+
+void SoftwarePresenter::setScale(int scale) {
+  scale = std::max(scale, 1);
+  if (scale == m_scale)
+    return;
+  m_scale = scale;
+  createTexture();
+}
+
+void SoftwarePresenter::setPalette(const std::uint8_t *palette, int numColors) {
+  m_expander.setPalette(palette, numColors);
+}
+
+void SoftwarePresenter::createTexture() {
+  if (m_texture) {
+    SDL_DestroyTexture(m_texture);
+    m_texture = nullptr;
+  }
+
+  if (!m_renderer) {
+    m_pixels.assign(static_cast<std::size_t>(m_width) * m_scale * m_height * m_scale, 0);
+    return;
+  }
+
+  m_texture = SDL_CreateTexture(m_renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING,
+                                m_width * m_scale, m_height * m_scale);
+  if (!m_texture) {
+    std::ostringstream ss;
+    ss << "Error when creating the streaming texture (error=" << SDL_GetError() << ")";
+    throw std::runtime_error(ss.str());
+  }
+  // the renderer scales the image to the window and fills the remaining bars
+  SDL_RenderSetLogicalSize(m_renderer, m_width * m_scale, m_height * m_scale);
+}
+
+void SoftwarePresenter::present(const std::uint8_t *image) {
+  if (!m_texture) {
+    m_expander.expand(image, m_width, m_height, m_scale, reinterpret_cast<std::uint8_t *>(m_pixels.data()),
+                      static_cast<std::size_t>(m_width) * m_scale * sizeof(std::uint32_t));
+    return;
+  }
+
+  // the locked memory is write-only and may be the texture itself, every pixel is written once
+  void *pixels = nullptr;
+  int pitch = 0;
+  if (SDL_LockTexture(m_texture, nullptr, &pixels, &pitch) != 0) {
+    std::ostringstream ss;
+    ss << "Error when locking the streaming texture (error=" << SDL_GetError() << ")";
+    throw std::runtime_error(ss.str());
+  }
+  m_expander.expand(image, m_width, m_height, m_scale, static_cast<std::uint8_t *>(pixels), static_cast<std::size_t>(pitch));
+  SDL_UnlockTexture(m_texture);
+
+  SDL_SetRenderDrawColor(m_renderer, 0, 0, 0, 0xFF);
+  SDL_RenderClear(m_renderer);
+  SDL_RenderCopy(m_renderer, m_texture, nullptr, nullptr);
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <SDL.h>
+#include "PaletteExpander.h"
+
+/// Presents fire images without OpenGL: the palette indices are expanded to RGBA on the CPU and streamed
+/// into an SDL texture, which the SDL renderer scales to the window with letterboxing.
+///
+/// Without a renderer (headless) the images are only expanded into memory, that still measures the CPU side of the path.
+class SoftwarePresenter {
+public:
+  /// \param renderer: Specifies the renderer of the window, nullptr to only expand the images.
+  /// \param width: Specifies the width of the images to present.
+  /// \param height: Specifies the height of the images to present.
+  /// \param palette: Specifies the colors as RGB triplets.
+  /// \param numColors: Specifies the number of colors of the palette, at most 256.
+  SoftwarePresenter(SDL_Renderer *renderer, int width, int height, const std::uint8_t *palette, int numColors);
+  ~SoftwarePresenter();
+
+  SoftwarePresenter(const SoftwarePresenter &) = delete;
+  SoftwarePresenter &operator=(const SoftwarePresenter &) = delete;
+
+  /// Changes the size of the images to present.
+  void resize(int width, int height);
+  /// Upscales the images by an integer factor while expanding them, the renderer then has less or nothing to scale.
+  void setScale(int scale);
+  [[nodiscard]] int getScale() const noexcept { return m_scale; }
+  /// Changes the colors, indices past the end of the palette are drawn black.
+  void setPalette(const std::uint8_t *palette, int numColors);
+
+  /// Expands an image of palette indices and draws it, the window shows it after Window::display().
+  /// \param image: Specifies the palette indices, width * height bytes.
+  void present(const std::uint8_t *image);
+
+  [[nodiscard]] PaletteExpander &getExpander() noexcept { return m_expander; }
+
+  /// Returns the RGBA pixels of the last image (upscaled) when there is no renderer, nullptr otherwise.
+  [[nodiscard]] const std::uint32_t *getPixels() const noexcept {
+    return m_pixels.empty() ? nullptr : m_pixels.data();
+  }
+  [[nodiscard]] int getWidth() const noexcept { return m_width; }
+  [[nodiscard]] int getHeight() const noexcept { return m_height; }
+
+private:
+  void createTexture();
+
+private:
+  SDL_Renderer *m_renderer;
+  SDL_Texture *m_texture{nullptr};
+  int m_width;
+  int m_height;
+  int m_scale{1};
+  PaletteExpander m_expander;
+  // expanded image, only used without a renderer
+  std::vector<std::uint32_t> m_pixels;
+};
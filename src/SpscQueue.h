@@ -0,0 +1,60 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include "Util.h"
+
+/// Bounded lock-free queue between exactly one producer thread and one consumer thread.
+///
+/// Each side owns one index and only reads the other one, a push or a pop is a load, a store and a move:
+/// neither side ever waits for the other. When the queue is full or empty the call fails, the caller picks
+/// what to do: spin, sleep, or give up.
+template<typename T>
+class SpscQueue {
+public:
+  /// \param capacity: Specifies the minimum number of items, it is rounded up to a power of two.
+  explicit SpscQueue(std::size_t capacity)
+      : m_items(Util::nextPow2(static_cast<unsigned int>(std::max<std::size_t>(capacity, 2)))),
+        m_mask(m_items.size() - 1) {}
+
+  SpscQueue(const SpscQueue &) = delete;
+  SpscQueue &operator=(const SpscQueue &) = delete;
+
+  /// Called by the producer only, returns false when the queue is full and leaves the value untouched.
+  bool tryPush(T &&value) {
+    const auto tail = m_tail.load(std::memory_order_relaxed);
+    if (tail - m_head.load(std::memory_order_acquire) == m_items.size())
+      return false;
+    m_items[tail & m_mask] = std::move(value);
+    // publishes the item before the new tail
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// Called by the consumer only, returns false when the queue is empty.
+  bool tryPop(T &value) {
+    const auto head = m_head.load(std::memory_order_relaxed);
+    if (head == m_tail.load(std::memory_order_acquire))
+      return false;
+    value = std::move(m_items[head & m_mask]);
+    // the slot can be reused by the producer once the new head is visible
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// Returns the number of items, only a snapshot when the other side is running.
+  [[nodiscard]] std::size_t size() const noexcept {
+    return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+  }
+
+  [[nodiscard]] std::size_t capacity() const noexcept { return m_items.size(); }
+
+private:
+  std::vector<T> m_items;
+  std::size_t m_mask;
+  // on separate cache lines, each side writes its own index without invalidating the other's
+  alignas(64) std::atomic<std::size_t> m_head{0};
+  alignas(64) std::atomic<std::size_t> m_tail{0};
+};
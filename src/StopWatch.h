@@ -3,20 +3,29 @@
 
 class StopWatch {
 public:
-  StopWatch() : m_startTime(TimeSpan::milliseconds(SDL_GetTicks())) {
+  StopWatch() : m_startTime(now()) {
   }
 
   [[nodiscard]] TimeSpan getElapsedTime() const {
-    return TimeSpan::milliseconds(SDL_GetTicks()) - m_startTime;
+    return now() - m_startTime;
   }
 
   TimeSpan restart() {
-    TimeSpan now = TimeSpan::milliseconds(SDL_GetTicks());
+    TimeSpan now = StopWatch::now();
     TimeSpan elapsed = now - m_startTime;
     m_startTime = now;
     return elapsed;
   }
 
+private:
+  // the performance counter gives sub-millisecond steps, needed to interpolate between simulation ticks
+  static TimeSpan now() {
+    static const Uint64 frequency = SDL_GetPerformanceFrequency();
+    constexpr Uint64 TicksPerSecond = 10000000;
+    auto counter = SDL_GetPerformanceCounter();
+    return TimeSpan{static_cast<long>((counter / frequency) * TicksPerSecond + (counter % frequency) * TicksPerSecond / frequency)};
+  }
+
 private:
   TimeSpan m_startTime;
 };
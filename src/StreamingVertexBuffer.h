@@ -0,0 +1,178 @@
+#pragma once
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <GL/glew.h>
+#include "Debug.h"
+#include "GlCapabilities.h"
+#include "VertexBuffer.h"
+
+/// Vertex buffer for data respecified every frame (overlays, particles, instance transforms).
+/// Allocations are carved from a ring that never reallocates its storage:
+/// - with GL 4.4 or ARB_buffer_storage the storage is persistently mapped and split in one region
+///   per frame in flight, a fence protects each region until the GPU has consumed it,
+/// - otherwise the ring is written with unsynchronized mappings and orphaned when it wraps.
+class StreamingVertexBuffer {
+public:
+  static constexpr std::size_t FramesInFlight = 3;
+
+  struct Stats {
+    /// Number of times a frame had to wait for the GPU to release its region.
+    int stalls{0};
+    /// Number of times the storage has been orphaned.
+    int orphans{0};
+  };
+
+  /// \param type: Specifies the target to which the buffer object is bound.
+  /// \param frameCapacity: Specifies the maximum size in bytes written during one frame.
+  StreamingVertexBuffer(VertexBuffer::Type type, std::size_t frameCapacity)
+      : m_buffer(type), m_frameCapacity(frameCapacity), m_capacity(frameCapacity * FramesInFlight),
+        m_dsa(GlCapabilities::get().directStateAccess), m_persistent(GlCapabilities::get().bufferStorage) {
+    if (m_persistent) {
+      constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+      if (m_dsa) {
+        GL_CHECK(glNamedBufferStorage(m_buffer.getHandle(), m_capacity, nullptr, flags));
+        GL_CHECK(m_mapped = static_cast<std::uint8_t *>(glMapNamedBufferRange(m_buffer.getHandle(), 0, m_capacity, flags)));
+      } else {
+        GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer.getHandle()));
+        GL_CHECK(glBufferStorage(GL_COPY_WRITE_BUFFER, m_capacity, nullptr, flags));
+        GL_CHECK(m_mapped = static_cast<std::uint8_t *>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, m_capacity, flags)));
+        GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+      }
+      if (!m_mapped) {
+        throw std::runtime_error("Unable to map the streaming vertex buffer");
+      }
+    } else {
+      m_buffer.buffer(m_capacity, nullptr, VertexBuffer::Usage::Stream);
+    }
+  }
+
+  ~StreamingVertexBuffer() {
+    for (auto fence : m_fences) {
+      if (fence) {
+        glDeleteSync(fence);
+      }
+    }
+    if (m_mapped) {
+      if (m_dsa) {
+        glUnmapNamedBuffer(m_buffer.getHandle());
+      } else {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer.getHandle());
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+      }
+    }
+  }
+
+  StreamingVertexBuffer(const StreamingVertexBuffer &) = delete;
+  StreamingVertexBuffer &operator=(const StreamingVertexBuffer &) = delete;
+
+  /// Copies data into the ring.
+  /// \param data: Specifies a pointer to the data to copy.
+  /// \param size: Specifies the size in bytes of the data.
+  /// \param alignment: Specifies the alignment in bytes of the returned offset, a power of two.
+  /// \return the offset in bytes of the data in the buffer, to pass to VertexArray::setVertexBuffer.
+  std::size_t write(const void *data, std::size_t size, std::size_t alignment = 16) {
+    assert((alignment & (alignment - 1)) == 0);
+    if (m_persistent) {
+      waitForRegion();
+      auto offset = (m_frameOffset + alignment - 1) & ~(alignment - 1);
+      if (offset + size > m_frameCapacity) {
+        throw std::runtime_error("Streaming vertex buffer frame capacity exceeded");
+      }
+      auto position = m_region * m_frameCapacity + offset;
+      memcpy(m_mapped + position, data, size);
+      m_frameOffset = offset + size;
+      return position;
+    }
+
+    auto offset = (m_head + alignment - 1) & ~(alignment - 1);
+    if (size > m_capacity) {
+      throw std::runtime_error("Streaming vertex buffer capacity exceeded");
+    }
+    if (offset + size > m_capacity) {
+      // the driver hands out fresh storage while the GPU keeps reading the old one
+      m_buffer.buffer(m_capacity, nullptr, VertexBuffer::Usage::Stream);
+      m_stats.orphans++;
+      offset = 0;
+    }
+    // nothing written since the last orphaning overlaps the range, there is no need to synchronize
+    constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+    void *ptr;
+    if (m_dsa) {
+      GL_CHECK(ptr = glMapNamedBufferRange(m_buffer.getHandle(), offset, size, flags));
+      memcpy(ptr, data, size);
+      GL_CHECK(glUnmapNamedBuffer(m_buffer.getHandle()));
+    } else {
+      GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer.getHandle()));
+      GL_CHECK(ptr = glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, size, flags));
+      memcpy(ptr, data, size);
+      GL_CHECK(glUnmapBuffer(GL_COPY_WRITE_BUFFER));
+      GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+    }
+    m_head = offset + size;
+    return offset;
+  }
+
+  /// Marks the end of the draws using this frame's allocations, it has to be called once per frame.
+  void endFrame() {
+    if (!m_persistent)
+      return;
+    if (m_frameOffset > 0) {
+      m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    m_region = (m_region + 1) % FramesInFlight;
+    m_frameOffset = 0;
+    m_regionReady = false;
+  }
+
+  [[nodiscard]] const VertexBuffer &getBuffer() const noexcept {
+    return m_buffer;
+  }
+
+  [[nodiscard]] bool isPersistent() const noexcept {
+    return m_persistent;
+  }
+
+  [[nodiscard]] const Stats &getStats() const noexcept {
+    return m_stats;
+  }
+
+private:
+  void waitForRegion() {
+    if (m_regionReady)
+      return;
+    m_regionReady = true;
+    auto fence = m_fences[m_region];
+    if (!fence)
+      return;
+
+    auto status = glClientWaitSync(fence, 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+      m_stats.stalls++;
+      while (status == GL_TIMEOUT_EXPIRED) {
+        status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+      }
+    }
+    glDeleteSync(fence);
+    m_fences[m_region] = nullptr;
+  }
+
+private:
+  VertexBuffer m_buffer;
+  std::size_t m_frameCapacity;
+  std::size_t m_capacity;
+  bool m_dsa;
+  bool m_persistent;
+  std::uint8_t *m_mapped{nullptr};
+  // persistent mode: current region and write offset in it
+  std::size_t m_region{0};
+  std::size_t m_frameOffset{0};
+  bool m_regionReady{false};
+  std::array<GLsync, FramesInFlight> m_fences{};
+  // orphaning mode: write offset in the whole buffer
+  std::size_t m_head{0};
+  Stats m_stats{};
+};
@@ -0,0 +1,273 @@
+#include "TerminalRenderer.h"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+constexpr const char *UpperHalf = "\xE2\x96\x80";
+constexpr const char *LowerHalf = "\xE2\x96\x84";
+constexpr const char *FullBlock = "\xE2\x96\x88";
+constexpr int DefaultColumns = 80;
+constexpr int DefaultRows = 24;
+// intensities a cell may drift from the colors it was drawn with before it is redrawn: the averages hesitate
+// between neighbors of the ramp, which look the same
+constexpr int Tolerance = 1;
+
+int getEnvironmentSize(const char *name, int defaultValue) {
+  const auto value = std::getenv(name);
+  const auto size = value ? std::atoi(value) : 0;
+  return size > 0 ? size : defaultValue;
+}
+}// namespace
+
+TerminalRenderer::TerminalRenderer(const std::uint8_t *palette, int numColors, std::FILE *output) : m_output(output) {
+  setPalette(palette, numColors);
+  // the alternate screen keeps the shell history as it was, the cursor would blink over the fire
+  m_buffer = "\x1b[?1049h\x1b[?25l";
+  write();
+#if defined(__unix__) || defined(__APPLE__)
+  // the keys typed would be echoed over the fire, where the cells that did not change are never redrawn
+  if (::isatty(STDIN_FILENO) && ::tcgetattr(STDIN_FILENO, &m_inputMode) == 0) {
+    auto mode = m_inputMode;
+    mode.c_lflag &= ~static_cast<tcflag_t>(ECHO | ICANON);
+    m_inputModeSaved = ::tcsetattr(STDIN_FILENO, TCSANOW, &mode) == 0;
+  }
+  // messages redirected to a file or a pipe do not need a redraw
+  if (::isatty(STDERR_FILENO) || ::isatty(STDOUT_FILENO)) {
+    m_messages = std::make_unique<MessageBuffer>(std::cerr.rdbuf());
+    m_coutBuffer = std::cout.rdbuf(m_messages.get());
+    m_cerrBuffer = std::cerr.rdbuf(m_messages.get());
+  }
+#endif
+}
+
+TerminalRenderer::~TerminalRenderer() {
+  if (m_messages) {
+    std::cout.rdbuf(m_coutBuffer);
+    std::cerr.rdbuf(m_cerrBuffer);
+  }
+#if defined(__unix__) || defined(__APPLE__)
+  if (m_inputModeSaved) {
+    ::tcsetattr(STDIN_FILENO, TCSANOW, &m_inputMode);
+  }
+#endif
+  m_buffer = "\x1b[0m\x1b[?25h\x1b[?1049l";
+  write();
+}
+
+TerminalRenderer::MessageBuffer::int_type TerminalRenderer::MessageBuffer::overflow(int_type c) {
+  m_written = true;
+  return traits_type::eq_int_type(c, traits_type::eof()) ? traits_type::not_eof(c) : m_target->sputc(static_cast<char>(c));
+}
+
+std::streamsize TerminalRenderer::MessageBuffer::xsputn(const char *s, std::streamsize count) {
+  m_written = true;
+  return m_target->sputn(s, count);
+}
+
+int TerminalRenderer::MessageBuffer::sync() {
+  return m_target->pubsync();
+}
+
+void TerminalRenderer::setPalette(const std::uint8_t *palette, int numColors) {
+  numColors = std::clamp(numColors, 0, 256);
+  for (auto i = 0; i < 256; ++i) {
+    std::string rgb = "0;0;0m";
+    if (i < numColors) {
+      rgb = std::to_string(palette[i * 3]) + ';' + std::to_string(palette[i * 3 + 1]) + ';'
+            + std::to_string(palette[i * 3 + 2]) + 'm';
+    }
+    // the sequences of both colors merge into one when a cell changes both
+    m_foregrounds[static_cast<std::size_t>(i)] = "38;2;" + rgb;
+    m_backgrounds[static_cast<std::size_t>(i)] = "48;2;" + rgb;
+  }
+  m_cells.clear();
+}
+
+void TerminalRenderer::setTitle(const std::string &title) {
+  m_buffer = "\x1b]0;" + title + "\x07";
+  write();
+}
+
+void TerminalRenderer::updateSize() {
+  auto columns = 0;
+  auto rows = 0;
+#if defined(__unix__) || defined(__APPLE__)
+  winsize size{};
+  if (::ioctl(fileno(m_output), TIOCGWINSZ, &size) == 0) {
+    columns = size.ws_col;
+    rows = size.ws_row;
+  }
+#endif
+  // not a terminal: a file or a pipe, the shell may still tell the size
+  if (columns <= 0 || rows <= 0) {
+    columns = getEnvironmentSize("COLUMNS", DefaultColumns);
+    rows = getEnvironmentSize("LINES", DefaultRows);
+  }
+  if (columns != m_columns || rows != m_rows) {
+    m_columns = columns;
+    m_rows = rows;
+    m_cells.clear();
+  }
+}
+
+void TerminalRenderer::appendNumber(int value) {
+  char digits[12];
+  auto result = std::to_chars(digits, digits + sizeof(digits), value);
+  m_buffer.append(digits, result.ptr);
+}
+
+void TerminalRenderer::downsample(const std::uint8_t *image, int width, int height) {
+  const auto pixelRows = m_rows * 2;
+  m_pixels.resize(static_cast<std::size_t>(m_columns) * pixelRows);
+  m_columnStarts.resize(static_cast<std::size_t>(m_columns) + 1);
+  m_sums.resize(static_cast<std::size_t>(m_columns));
+  for (auto column = 0; column <= m_columns; ++column) {
+    m_columnStarts[static_cast<std::size_t>(column)] = column * width / m_columns;
+  }
+
+  for (auto row = 0; row < pixelRows; ++row) {
+    // a terminal larger than the image repeats its pixels
+    const auto y0 = row * height / pixelRows;
+    const auto y1 = std::max((row + 1) * height / pixelRows, y0 + 1);
+    std::fill(m_sums.begin(), m_sums.end(), 0u);
+    for (auto y = y0; y < y1; ++y) {
+      const auto src = image + static_cast<std::size_t>(y) * width;
+      for (auto column = 0; column < m_columns; ++column) {
+        const auto x0 = m_columnStarts[static_cast<std::size_t>(column)];
+        const auto x1 = std::max(m_columnStarts[static_cast<std::size_t>(column) + 1], x0 + 1);
+        auto sum = 0u;
+        for (auto x = x0; x < x1; ++x) {
+          sum += src[x];
+        }
+        m_sums[static_cast<std::size_t>(column)] += sum;
+      }
+    }
+    auto dst = m_pixels.data() + static_cast<std::size_t>(row) * m_columns;
+    for (auto column = 0; column < m_columns; ++column) {
+      const auto x0 = m_columnStarts[static_cast<std::size_t>(column)];
+      const auto x1 = std::max(m_columnStarts[static_cast<std::size_t>(column) + 1], x0 + 1);
+      const auto count = static_cast<std::uint32_t>((x1 - x0) * (y1 - y0));
+      dst[column] = static_cast<std::uint8_t>((m_sums[static_cast<std::size_t>(column)] + count / 2) / count);
+    }
+  }
+}
+
+void TerminalRenderer::present(const std::uint8_t *image, int width, int height) {
+  const auto start = std::chrono::steady_clock::now();
+  if (m_messages && m_messages->takeWritten()) {
+    redraw();
+  }
+  updateSize();
+  downsample(image, width, height);
+  const auto full = m_cells.empty();
+  if (full) {
+    m_cells.assign(static_cast<std::size_t>(m_columns) * m_rows, 0);
+  }
+
+  m_buffer = "\x1b[?2026h";
+  if (full) {
+    m_buffer += "\x1b[0m\x1b[2J";
+  }
+  // colors of the terminal, unknown at the start of a frame: something else may have written in between
+  auto foreground = -1;
+  auto background = -1;
+  // writes a cell with the glyph needing the fewest color changes
+  auto appendCell = [&](int top, int bottom) {
+    if (top == bottom) {
+      if (background == top) {
+        m_buffer += ' ';
+      } else if (foreground == top) {
+        m_buffer += FullBlock;
+      } else {
+        m_buffer += "\x1b[";
+        m_buffer += m_backgrounds[static_cast<std::size_t>(top)];
+        background = top;
+        m_buffer += ' ';
+      }
+      return;
+    }
+    const auto upperChanges = (foreground != top) + (background != bottom);
+    const auto lowerChanges = (foreground != bottom) + (background != top);
+    const auto upper = upperChanges <= lowerChanges;
+    const auto fg = upper ? top : bottom;
+    const auto bg = upper ? bottom : top;
+    if (foreground != fg) {
+      m_buffer += "\x1b[";
+      m_buffer += m_foregrounds[static_cast<std::size_t>(fg)];
+      foreground = fg;
+      if (background != bg) {
+        m_buffer.back() = ';';
+        m_buffer += m_backgrounds[static_cast<std::size_t>(bg)];
+        background = bg;
+      }
+    } else if (background != bg) {
+      m_buffer += "\x1b[";
+      m_buffer += m_backgrounds[static_cast<std::size_t>(bg)];
+      background = bg;
+    }
+    m_buffer += upper ? UpperHalf : LowerHalf;
+  };
+  auto isFree = [&](int top, int bottom) {
+    return top == bottom ? background == top || foreground == top
+                         : (foreground == top && background == bottom) || (foreground == bottom && background == top);
+  };
+
+  std::uint64_t changed = 0;
+  for (auto row = 0; row < m_rows; ++row) {
+    const auto topRow = m_pixels.data() + static_cast<std::size_t>(row * 2) * m_columns;
+    const auto bottomRow = topRow + m_columns;
+    auto cells = m_cells.data() + static_cast<std::size_t>(row) * m_columns;
+    // column of the cursor in this row, -1 before the first cell written
+    auto cursor = -1;
+    for (auto column = 0; column < m_columns; ++column) {
+      const int top = topRow[column];
+      const int bottom = bottomRow[column];
+      const auto drawn = cells[column];
+      if (!full && std::abs((drawn >> 8) - top) <= Tolerance && std::abs((drawn & 0xFF) - bottom) <= Tolerance)
+        continue;
+      cells[column] = static_cast<std::uint16_t>(top << 8 | bottom);
+      changed++;
+
+      if (cursor != column) {
+        const auto gap = column - cursor;
+        const int skipped = cursor >= 0 && gap == 1 ? cells[column - 1] : 0;
+        if (cursor >= 0 && gap == 1 && isFree(skipped >> 8, skipped & 0xFF)) {
+          // rewriting the unchanged cell costs less than moving over it
+          appendCell(skipped >> 8, skipped & 0xFF);
+        } else if (cursor >= 0) {
+          m_buffer += "\x1b[";
+          appendNumber(gap);
+          m_buffer += 'C';
+        } else {
+          m_buffer += "\x1b[";
+          appendNumber(row + 1);
+          m_buffer += ';';
+          appendNumber(column + 1);
+          m_buffer += 'H';
+        }
+      }
+      appendCell(top, bottom);
+      cursor = column + 1;
+    }
+  }
+  m_buffer += "\x1b[?2026l";
+  write();
+
+  m_stats.frames++;
+  m_stats.cells += static_cast<std::uint64_t>(m_columns) * m_rows;
+  m_stats.changedCells += changed;
+  m_stats.renderTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void TerminalRenderer::write() {
+  std::fwrite(m_buffer.data(), 1, m_buffer.size(), m_output);
+  std::fflush(m_output);
+  m_stats.bytes += m_buffer.size();
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <vector>
+#if defined(__unix__) || defined(__APPLE__)
+#include <termios.h>
+#endif
+
+/// Draws fire images in a terminal with 24-bit colors, to watch the fire over SSH without a display.
+///
+/// Each character cell shows two pixels, the averages of the areas of the image they cover: an upper half block in
+/// the foreground color over the background color. Averaging rather than sampling keeps the cells from flickering
+/// with the noise of the fire, they change when the flames do.
+/// Only the cells that changed since the previous frame are written: a run of changed cells costs one cursor move,
+/// and a color is only sent when it differs from the one the terminal is already using. A frame is written in one
+/// call, inside the synchronized update markers of the terminals that support them.
+/// The keys typed are not echoed while the fire is drawn, and a message written to std::cout or std::cerr on the
+/// terminal makes the next frame redraw every cell: the cells it wrote over did not change in the image.
+class TerminalRenderer {
+public:
+  struct Stats {
+    std::uint64_t frames{0};
+    std::uint64_t bytes{0};
+    std::uint64_t cells{0};
+    std::uint64_t changedCells{0};
+    /// Time spent building and writing the frames, in milliseconds.
+    double renderTime{0};
+  };
+
+  /// Switches the terminal to its alternate screen without echo, the destructor restores it.
+  /// \param palette: Specifies the colors as RGB triplets.
+  /// \param numColors: Specifies the number of colors of the palette, at most 256.
+  /// \param output: Specifies the terminal.
+  TerminalRenderer(const std::uint8_t *palette, int numColors, std::FILE *output = stdout);
+  ~TerminalRenderer();
+
+  TerminalRenderer(const TerminalRenderer &) = delete;
+  TerminalRenderer &operator=(const TerminalRenderer &) = delete;
+
+  /// Changes the colors, the next frame redraws every cell.
+  void setPalette(const std::uint8_t *palette, int numColors);
+  /// Shows a text in the title bar of the terminal.
+  void setTitle(const std::string &title);
+  /// Draws every cell at the next frame, after something else wrote to the terminal.
+  void redraw() { m_cells.clear(); }
+
+  /// Draws an image scaled to the terminal, its size is checked at each frame.
+  /// \param image: Specifies the palette indices, width * height bytes, rows from top to bottom.
+  void present(const std::uint8_t *image, int width, int height);
+
+  [[nodiscard]] const Stats &getStats() const noexcept { return m_stats; }
+
+private:
+  /// Forwards the messages to the terminal and tells the renderer they were written over the fire.
+  class MessageBuffer : public std::streambuf {
+  public:
+    explicit MessageBuffer(std::streambuf *target) : m_target(target) {}
+
+    /// Returns true when a message was written since the last call.
+    bool takeWritten() noexcept { return m_written.exchange(false); }
+
+  protected:
+    int_type overflow(int_type c) override;
+    std::streamsize xsputn(const char *s, std::streamsize count) override;
+    int sync() override;
+
+  private:
+    std::streambuf *m_target;
+    std::atomic<bool> m_written{false};
+  };
+
+  void updateSize();
+  void downsample(const std::uint8_t *image, int width, int height);
+  void appendNumber(int value);
+  void write();
+
+private:
+  std::FILE *m_output;
+  // color escape sequences of each palette index, the foreground ones then the background ones
+  std::array<std::string, 256> m_foregrounds;
+  std::array<std::string, 256> m_backgrounds;
+  int m_columns{0};
+  int m_rows{0};
+  // image at the resolution of the terminal, two rows of pixels per row of cells
+  std::vector<std::uint8_t> m_pixels;
+  std::vector<int> m_columnStarts;
+  std::vector<std::uint32_t> m_sums;
+  // palette indices of the upper and lower halves of the cells drawn, a full redraw when empty
+  std::vector<std::uint16_t> m_cells;
+  std::string m_buffer;
+  Stats m_stats;
+  // std::cout and std::cerr go through it when they write to a terminal
+  std::unique_ptr<MessageBuffer> m_messages;
+  std::streambuf *m_coutBuffer{nullptr};
+  std::streambuf *m_cerrBuffer{nullptr};
+#if defined(__unix__) || defined(__APPLE__)
+  bool m_inputModeSaved{false};
+  termios m_inputMode{};
+#endif
+};
@@ -2,6 +2,7 @@
 #include <cassert>
 #include <GL/glew.h>
 #include "Debug.h"
+#include "GlCapabilities.h"
 
 class Texture {
 public:
@@ -9,33 +10,61 @@ public:
     Rgba,
     Rgb,
     Alpha,
+    /// 8-bit unsigned integer texel (GL_R8UI), read with a usampler and texelFetch, never filtered.
+    Index,
   };
 
   enum class Type {
     Texture1D,
     Texture2D,
+    Texture2DArray,
   };
 
   explicit Texture(Type type = Type::Texture2D, Format format = Format::Rgba)
       : m_type(type), m_format{format} {
-    GL_CHECK(glGenTextures(1, &m_img_tex));
+    create();
   }
 
   Texture(Format format, const int width, const int height, const void *data)
       : m_type(Type::Texture2D), m_format{format} {
-    GL_CHECK(glGenTextures(1, &m_img_tex));
-    bind();
-    auto glFormat = getGlFormat(format);
-    glTexImage2D(GL_TEXTURE_2D, 0, glFormat, width, height, 0, glFormat, GL_UNSIGNED_BYTE, data);
+    create();
+    if (m_dsa) {
+      GL_CHECK(glTextureStorage2D(m_img_tex, 1, getGlInternalFormat(format), width, height));
+      if (data) {
+        GL_CHECK(glTextureSubImage2D(m_img_tex, 0, 0, 0, width, height, getGlFormat(format), GL_UNSIGNED_BYTE, data));
+      }
+    } else {
+      bind();
+      glTexImage2D(GL_TEXTURE_2D, 0, getGlInternalFormat(format), width, height, 0, getGlFormat(format), GL_UNSIGNED_BYTE, data);
+    }
     updateFilters();
   }
 
   Texture(Format format, const int width, const void *data)
       : m_type(Type::Texture1D), m_format{format} {
-    GL_CHECK(glGenTextures(1, &m_img_tex));
-    bind();
-    auto glFormat = getGlFormat(format);
-    glTexImage1D(GL_TEXTURE_1D, 0, glFormat, width, 0, glFormat, GL_UNSIGNED_BYTE, data);
+    create();
+    if (m_dsa) {
+      GL_CHECK(glTextureStorage1D(m_img_tex, 1, getGlInternalFormat(format), width));
+      if (data) {
+        GL_CHECK(glTextureSubImage1D(m_img_tex, 0, 0, width, getGlFormat(format), GL_UNSIGNED_BYTE, data));
+      }
+    } else {
+      bind();
+      glTexImage1D(GL_TEXTURE_1D, 0, getGlInternalFormat(format), width, 0, getGlFormat(format), GL_UNSIGNED_BYTE, data);
+    }
+    updateFilters();
+  }
+
+  /// Creates a 2D array texture, its layers are filled with setLayer.
+  Texture(Format format, const int width, const int height, const int layers)
+      : m_type(Type::Texture2DArray), m_format{format} {
+    create();
+    if (m_dsa) {
+      GL_CHECK(glTextureStorage3D(m_img_tex, 1, getGlInternalFormat(format), width, height, layers));
+    } else {
+      bind();
+      glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, getGlInternalFormat(format), width, height, layers, 0, getGlFormat(format), GL_UNSIGNED_BYTE, nullptr);
+    }
     updateFilters();
   }
 
@@ -44,6 +73,8 @@ public:
   }
 
   void setSmooth(bool smooth = true) {
+    // integer textures are incomplete with linear filtering
+    assert(!smooth || m_format != Format::Index);
     if (m_smooth == smooth) {
       return;
     }
@@ -53,7 +84,9 @@ public:
     if (!m_img_tex)
       return;
 
-    GL_CHECK(glBindTexture(getGlType(m_type), m_img_tex));
+    if (!m_dsa) {
+      bind();
+    }
     updateFilters();
   }
 
@@ -62,15 +95,35 @@ public:
   }
 
   void setData(const int width, const int height, const void *data) const {
+    auto format = getGlFormat(m_format);
+    if (m_dsa) {
+      if (m_type == Type::Texture2D) {
+        GL_CHECK(glTextureSubImage2D(m_img_tex, 0, 0, 0, width, height, format, GL_UNSIGNED_BYTE, data));
+      } else {
+        GL_CHECK(glTextureSubImage1D(m_img_tex, 0, 0, width, format, GL_UNSIGNED_BYTE, data));
+      }
+      return;
+    }
+
     auto type = getGlType(m_type);
     GL_CHECK(glBindTexture(type, m_img_tex));
-    if(m_type == Type::Texture2D) {
-      GL_CHECK(glTexSubImage2D(type, 0, 0, 0, width, height, getGlFormat(m_format), GL_UNSIGNED_BYTE, data));
-    }else {
-      GL_CHECK(glTexSubImage1D(type, 0, 0, width, getGlFormat(m_format), GL_UNSIGNED_BYTE, data));
+    if (m_type == Type::Texture2D) {
+      GL_CHECK(glTexSubImage2D(type, 0, 0, 0, width, height, format, GL_UNSIGNED_BYTE, data));
+    } else {
+      GL_CHECK(glTexSubImage1D(type, 0, 0, width, format, GL_UNSIGNED_BYTE, data));
     }
-    GL_CHECK(glTexParameteri(type, GL_TEXTURE_MAG_FILTER, m_smooth ? GL_LINEAR : GL_NEAREST));
-    GL_CHECK(glTexParameteri(type, GL_TEXTURE_MIN_FILTER, getGlFilter(m_smooth)));
+  }
+
+  /// Replaces the content of a layer of a 2D array texture.
+  void setLayer(const int layer, const int width, const int height, const void *data) const {
+    assert(m_type == Type::Texture2DArray);
+    auto format = getGlFormat(m_format);
+    if (m_dsa) {
+      GL_CHECK(glTextureSubImage3D(m_img_tex, 0, 0, 0, layer, width, height, 1, format, GL_UNSIGNED_BYTE, data));
+      return;
+    }
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D_ARRAY, m_img_tex));
+    GL_CHECK(glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height, 1, format, GL_UNSIGNED_BYTE, data));
   }
 
   void bind() const {
@@ -78,15 +131,53 @@ public:
     GL_CHECK(glBindTexture(type, m_img_tex));
   }
 
+  /// Binds the texture to a texture unit.
+  void bind(unsigned int unit) const {
+    if (m_dsa) {
+      GL_CHECK(glBindTextureUnit(unit, m_img_tex));
+      return;
+    }
+    GL_CHECK(glActiveTexture(GL_TEXTURE0 + unit));
+    bind();
+  }
+
+  [[nodiscard]] unsigned int getHandle() const noexcept {
+    return m_img_tex;
+  }
+
+  void setLabel(const char *label) const {
+    labelObject(GL_TEXTURE, m_img_tex, label);
+  }
+
 private:
-  void updateFilters(){
+  void create() {
+    m_dsa = GlCapabilities::get().directStateAccess;
+    if (m_dsa) {
+      GL_CHECK(glCreateTextures(getGlType(m_type), 1, &m_img_tex));
+    } else {
+      GL_CHECK(glGenTextures(1, &m_img_tex));
+    }
+  }
+
+  void updateFilters() {
+    if (m_dsa) {
+      GL_CHECK(glTextureParameteri(m_img_tex, GL_TEXTURE_MAG_FILTER, getGlFilter(m_smooth)));
+      GL_CHECK(glTextureParameteri(m_img_tex, GL_TEXTURE_MIN_FILTER, getGlFilter(m_smooth)));
+      return;
+    }
     auto type = getGlType(m_type);
     GL_CHECK(glTexParameteri(type, GL_TEXTURE_MAG_FILTER, getGlFilter(m_smooth)));
     GL_CHECK(glTexParameteri(type, GL_TEXTURE_MIN_FILTER, getGlFilter(m_smooth)));
   }
 
   static GLenum getGlType(Type type) {
-    return type == Type::Texture2D ? GL_TEXTURE_2D : GL_TEXTURE_1D;
+    switch (type) {
+    case Type::Texture1D: return GL_TEXTURE_1D;
+    case Type::Texture2D: return GL_TEXTURE_2D;
+    case Type::Texture2DArray: return GL_TEXTURE_2D_ARRAY;
+    }
+    assert(false);
+    return GL_NONE;
   }
 
   static GLenum getGlFilter(bool smooth) {
@@ -94,17 +185,32 @@ private:
   }
 
   static GLenum getGlFormat(Format format) {
-    switch(format){
+    switch (format) {
     case Format::Alpha: return GL_RED;
+    case Format::Index: return GL_RED_INTEGER;
     case Format::Rgba: return GL_RGBA;
     case Format::Rgb: return GL_RGB;
     }
     assert(false);
+    return GL_NONE;
+  }
+
+  // immutable storage and integer textures need a sized internal format
+  static GLenum getGlInternalFormat(Format format) {
+    switch (format) {
+    case Format::Alpha: return GL_R8;
+    case Format::Index: return GL_R8UI;
+    case Format::Rgba: return GL_RGBA8;
+    case Format::Rgb: return GL_RGB8;
+    }
+    assert(false);
+    return GL_NONE;
   }
 
 private:
   Type m_type;
   Format m_format;
   bool m_smooth{false};
+  bool m_dsa{false};
   unsigned int m_img_tex{0};
-};
\ No newline at end of file
+};
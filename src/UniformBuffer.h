@@ -0,0 +1,61 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <GL/glew.h>
+#include "Debug.h"
+#include "GlCapabilities.h"
+
+class UniformBuffer {
+public:
+  /// Creates a uniform buffer object holding a std140 block.
+  /// \param size: Specifies the size in bytes of the block.
+  explicit UniformBuffer(std::size_t size) : m_size(size), m_dsa(GlCapabilities::get().directStateAccess) {
+    if (m_dsa) {
+      GL_CHECK(glCreateBuffers(1, &m_ubo));
+      GL_CHECK(glNamedBufferData(m_ubo, size, nullptr, GL_DYNAMIC_DRAW));
+      return;
+    }
+    GL_CHECK(glGenBuffers(1, &m_ubo));
+    GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, m_ubo));
+    GL_CHECK(glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW));
+    GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, 0));
+  }
+
+  ~UniformBuffer() {
+    GL_CHECK(glDeleteBuffers(1, &m_ubo));
+  }
+
+  /// Updates a part of the block.
+  /// \param offset: Specifies the offset in bytes, it has to follow the std140 layout of the block.
+  /// \param size: Specifies the size in bytes of the data.
+  /// \param data: Specifies a pointer to the data to copy.
+  void update(std::size_t offset, std::size_t size, const void *data) const {
+    assert(offset + size <= m_size);
+    if (m_dsa) {
+      GL_CHECK(glNamedBufferSubData(m_ubo, offset, size, data));
+      return;
+    }
+    GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, m_ubo));
+    GL_CHECK(glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data));
+    GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, 0));
+  }
+
+  template<typename T>
+  void update(const T &block) const {
+    update(0, sizeof(T), &block);
+  }
+
+  /// Attaches the buffer to a binding point, see Shader::setUniformBlock.
+  void bindBase(unsigned int binding) const {
+    GL_CHECK(glBindBufferBase(GL_UNIFORM_BUFFER, binding, m_ubo));
+  }
+
+  void setLabel(const char *label) const {
+    labelObject(GL_BUFFER, m_ubo, label);
+  }
+
+private:
+  std::size_t m_size;
+  bool m_dsa;
+  unsigned int m_ubo{0};
+};
@@ -1,4 +1,5 @@
 #include "Util.h"
+#include <cstring>
 
 namespace Util {
 unsigned int nextPow2(unsigned int x) {
@@ -11,6 +12,19 @@ unsigned int nextPow2(unsigned int x) {
   return x + 1;
 }
 
+void resample(const std::uint8_t *src, int srcWidth, int srcHeight, std::uint8_t *dst, int width, int height) {
+  if (srcWidth == width && srcHeight == height) {
+    std::memcpy(dst, src, static_cast<std::size_t>(width) * height);
+    return;
+  }
+  for (auto y = 0; y < height; y++) {
+    auto srcRow = &src[static_cast<std::size_t>(y * srcHeight / height) * srcWidth];
+    for (auto x = 0; x < width; x++) {
+      dst[static_cast<std::size_t>(y) * width + x] = srcRow[x * srcWidth / width];
+    }
+  }
+}
+
 void endianSwap(int32_t *value) {
   unsigned char *chs;
   unsigned char temp;
@@ -1,6 +1,7 @@
 #ifndef COLORCYCLING__UTIL_H
 #define COLORCYCLING__UTIL_H
 
+#include <cstddef>
 #include <cstdint>
 
 namespace Util {
@@ -8,6 +9,8 @@ void endianSwap(int32_t *value);
 void endianSwap(int16_t *value);
 void endianSwap(uint16_t *value);
 unsigned int nextPow2(unsigned int x);
+/// Scales an image of palette indices to another size, nearest neighbor; copies it when the sizes match.
+void resample(const std::uint8_t *src, int srcWidth, int srcHeight, std::uint8_t *dst, int width, int height);
 }// namespace Util
 
 #endif//COLORCYCLING__UTIL_H
@@ -1,24 +1,154 @@
 #pragma once
+#include <array>
+#include <cassert>
+#include <cstdint>
 #include <GL/glew.h>
+#include "Debug.h"
+#include "GlCapabilities.h"
+#include "VertexBuffer.h"
 
 class VertexArray {
 public:
-  VertexArray() {
-    glGenVertexArrays(1, &m_vao);
+  static constexpr std::size_t MaxBindings = 4;
+  static constexpr std::size_t MaxAttributes = 8;
+
+  VertexArray() : m_dsa(GlCapabilities::get().directStateAccess) {
+    if (m_dsa) {
+      GL_CHECK(glCreateVertexArrays(1, &m_vao));
+    } else {
+      GL_CHECK(glGenVertexArrays(1, &m_vao));
+    }
   }
 
   void bind() const {
     glBindVertexArray(m_vao);
   }
 
+  void setLabel(const char *label) const {
+    // a name generated without DSA is only a vertex array once it has been bound
+    if (!m_dsa) {
+      bind();
+    }
+    labelObject(GL_VERTEX_ARRAY, m_vao, label);
+  }
+
   ~VertexArray() {
-    glDeleteBuffers(1, &m_vao);
+    glDeleteVertexArrays(1, &m_vao);
   }
 
   static void unbind() {
     glBindVertexArray(0);
   }
 
+  /// Attaches a vertex buffer to a binding point of the vertex array.
+  /// \param binding: Specifies the binding point, attributes refer to it in setAttribute.
+  /// \param buffer: Specifies the vertex buffer.
+  /// \param offset: Specifies the offset in bytes of the first vertex in the buffer.
+  /// \param stride: Specifies the distance in bytes between two vertices.
+  void setVertexBuffer(unsigned int binding, const VertexBuffer &buffer, std::size_t offset, std::size_t stride) {
+    assert(binding < MaxBindings);
+    if (m_dsa) {
+      GL_CHECK(glVertexArrayVertexBuffer(m_vao, binding, buffer.getHandle(), static_cast<GLintptr>(offset), static_cast<GLsizei>(stride)));
+      return;
+    }
+    // without DSA the buffer is only captured when glVertexAttribPointer is called
+    auto divisor = m_bindings[binding].divisor;
+    m_bindings[binding] = {&buffer, offset, stride, divisor};
+    for (unsigned int location = 0; location < MaxAttributes; ++location) {
+      if (m_attributes[location].enabled && m_attributes[location].binding == binding) {
+        applyAttribute(location);
+      }
+    }
+  }
+
+  /// Sets the rate at which the attributes of a binding point advance.
+  /// \param divisor: 0 to advance per vertex, N to advance once every N instances.
+  void setBindingDivisor(unsigned int binding, unsigned int divisor) {
+    assert(binding < MaxBindings);
+    if (m_dsa) {
+      GL_CHECK(glVertexArrayBindingDivisor(m_vao, binding, divisor));
+      return;
+    }
+    // applied to the attributes when they are described
+    m_bindings[binding].divisor = divisor;
+    for (unsigned int location = 0; location < MaxAttributes; ++location) {
+      if (m_attributes[location].enabled && m_attributes[location].binding == binding) {
+        applyAttribute(location);
+      }
+    }
+  }
+
+  /// Attaches an element buffer to the vertex array.
+  void setElementBuffer(const VertexBuffer &buffer) const {
+    if (m_dsa) {
+      GL_CHECK(glVertexArrayElementBuffer(m_vao, buffer.getHandle()));
+      return;
+    }
+    bind();
+    buffer.bind();
+    unbind();
+  }
+
+  /// Enables and describes a vertex attribute.
+  /// \param location: Specifies the attribute location in the shader.
+  /// \param binding: Specifies the binding point of the vertex buffer holding the attribute.
+  /// \param size: Specifies the number of components of the attribute.
+  /// \param type: Specifies the data type of each component.
+  /// \param normalized: Specifies whether fixed-point data values should be normalized.
+  /// \param relativeOffset: Specifies the offset in bytes of the attribute in a vertex.
+  void setAttribute(unsigned int location, unsigned int binding, int size, GLenum type, bool normalized, std::size_t relativeOffset) {
+    assert(binding < MaxBindings);
+    if (m_dsa) {
+      GL_CHECK(glEnableVertexArrayAttrib(m_vao, location));
+      GL_CHECK(glVertexArrayAttribFormat(m_vao, location, size, type, normalized ? GL_TRUE : GL_FALSE, static_cast<GLuint>(relativeOffset)));
+      GL_CHECK(glVertexArrayAttribBinding(m_vao, location, binding));
+      return;
+    }
+
+    assert(location < MaxAttributes);
+    m_attributes[location] = {true, binding, size, type, normalized, relativeOffset};
+    applyAttribute(location);
+  }
+
+private:
+  void applyAttribute(unsigned int location) const {
+    const auto &attribute = m_attributes[location];
+    const auto &vb = m_bindings[attribute.binding];
+    assert(vb.buffer != nullptr);
+    bind();
+    vb.buffer->bind();
+    GL_CHECK(glEnableVertexAttribArray(location));
+    GL_CHECK(glVertexAttribPointer(location,
+                                   attribute.size,
+                                   attribute.type,
+                                   attribute.normalized ? GL_TRUE : GL_FALSE,
+                                   static_cast<GLsizei>(vb.stride),
+                                   reinterpret_cast<const void *>(static_cast<std::uintptr_t>(vb.offset + attribute.relativeOffset))));
+    GL_CHECK(glVertexAttribDivisor(location, vb.divisor));
+    unbind();
+    VertexBuffer::unbind(VertexBuffer::Type::Array);
+  }
+
 private:
+  struct Binding {
+    const VertexBuffer *buffer{nullptr};
+    std::size_t offset{0};
+    std::size_t stride{0};
+    unsigned int divisor{0};
+  };
+
+  // without DSA the attributes are described again when the buffer of their binding changes
+  struct Attribute {
+    bool enabled{false};
+    unsigned int binding{0};
+    int size{0};
+    GLenum type{GL_FLOAT};
+    bool normalized{false};
+    std::size_t relativeOffset{0};
+  };
+
+  bool m_dsa;
   unsigned int m_vao{0};
+  std::array<Binding, MaxBindings> m_bindings{};
+  std::array<Attribute, MaxAttributes> m_attributes{};
 };
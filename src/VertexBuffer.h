@@ -1,30 +1,54 @@
 #pragma once
 #include <GL/glew.h>
+#include "Debug.h"
+#include "GlCapabilities.h"
 
 class VertexBuffer {
 public:
   enum class Type {
     Array,
-    Element
+    Element,
+    /// Destination of glReadPixels, for readbacks that do not wait for the GPU.
+    PixelPack,
+  };
+
+  enum class Usage {
+    /// Specified once, drawn many times.
+    Static,
+    /// Respecified every frame.
+    Stream,
+    /// Written by the GPU every frame and read back by the CPU.
+    Read,
   };
 
   /// Creates a new data store for a buffer object.
   /// \param type: Specifies the target to which the buffer object is bound.
-  explicit VertexBuffer(Type type) : m_type(type) {
-    glGenBuffers(1, &m_vbo);
+  explicit VertexBuffer(Type type) : m_type(type), m_dsa(GlCapabilities::get().directStateAccess) {
+    if (m_dsa) {
+      GL_CHECK(glCreateBuffers(1, &m_vbo));
+    } else {
+      GL_CHECK(glGenBuffers(1, &m_vbo));
+    }
   }
 
   ~VertexBuffer() {
-    glDeleteBuffers(1, &m_vbo);
+    GL_CHECK(glDeleteBuffers(1, &m_vbo));
   }
 
   /// Sets new data to a buffer object.
   /// \param size: Specifies the size in bytes of the buffer object's new data store.
   /// \param data: Specifies a pointer to data that will be copied into the data store for initialization, or nullptr if no data is to be copied.
-  void buffer(size_t size, const void *data) const {
-    auto target = getTarget(m_type);
-    glBindBuffer(target, m_vbo);
-    glBufferData(target, size, data, GL_STATIC_DRAW);
+  /// \param usage: Specifies how often the data store is respecified.
+  void buffer(size_t size, const void *data, Usage usage = Usage::Static) const {
+    auto glUsage = getUsage(usage);
+    if (m_dsa) {
+      GL_CHECK(glNamedBufferData(m_vbo, size, data, glUsage));
+      return;
+    }
+    // the copy target is used so that neither the bound vertex array nor the array binding is disturbed
+    GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, m_vbo));
+    GL_CHECK(glBufferData(GL_COPY_WRITE_BUFFER, size, data, glUsage));
+    GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
   }
 
   void bind() const {
@@ -37,12 +61,36 @@ public:
     glBindBuffer(target, 0);
   }
 
+  [[nodiscard]] unsigned int getHandle() const noexcept {
+    return m_vbo;
+  }
+
+  /// Names the buffer in debug messages, without DSA it has to be called once the buffer has data.
+  void setLabel(const char *label) const {
+    labelObject(GL_BUFFER, m_vbo, label);
+  }
+
 private:
   static GLenum getTarget(Type type) {
-    return type == Type::Array ? GL_ARRAY_BUFFER : GL_ELEMENT_ARRAY_BUFFER;
+    switch (type) {
+    case Type::Array:return GL_ARRAY_BUFFER;
+    case Type::Element:return GL_ELEMENT_ARRAY_BUFFER;
+    case Type::PixelPack:return GL_PIXEL_PACK_BUFFER;
+    }
+    return GL_ARRAY_BUFFER;
+  }
+
+  static GLenum getUsage(Usage usage) {
+    switch (usage) {
+    case Usage::Static:return GL_STATIC_DRAW;
+    case Usage::Stream:return GL_STREAM_DRAW;
+    case Usage::Read:return GL_STREAM_READ;
+    }
+    return GL_STATIC_DRAW;
   }
 
 private:
   Type m_type;
+  bool m_dsa;
   unsigned int m_vbo{0};
-};
\ No newline at end of file
+};
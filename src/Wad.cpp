@@ -0,0 +1,188 @@
+#include "Wad.h"
+#include "Util.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+constexpr std::size_t HeaderSize = 12;
+constexpr std::size_t DirectoryEntrySize = 16;
+constexpr std::size_t LumpNameSize = 8;
+constexpr std::size_t PaletteSize = WadPalettes::NumColors * 3;
+constexpr std::size_t ColormapSize = WadPalettes::NumColors;
+
+constexpr bool isBigEndian() {
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__)
+  return __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__;
+#else
+  return false;
+#endif
+}
+
+// the WAD is little endian, the mapping has no alignment for the fields
+std::int32_t readInt32(const std::uint8_t *data) {
+  std::int32_t value;
+  std::memcpy(&value, data, sizeof(value));
+  if (isBigEndian()) {
+    Util::endianSwap(&value);
+  }
+  return value;
+}
+
+[[noreturn]] void throwInvalid(const std::string &path, const char *reason) {
+  std::ostringstream ss;
+  ss << "Invalid WAD " << path << ": " << reason;
+  throw std::runtime_error(ss.str());
+}
+}// namespace
+
+Wad::Wad(const std::string &path) : m_path(path), m_file(path) {
+  const auto data = m_file.data();
+  const auto size = m_file.size();
+  if (size < HeaderSize)
+    throwInvalid(path, "too small");
+  if (std::memcmp(data, "IWAD", 4) == 0) {
+    m_iwad = true;
+  } else if (std::memcmp(data, "PWAD", 4) != 0) {
+    throwInvalid(path, "not a WAD");
+  }
+
+  const auto lumpCount = readInt32(data + 4);
+  const auto directoryOffset = readInt32(data + 8);
+  if (lumpCount < 0 || directoryOffset < 0 || static_cast<std::size_t>(directoryOffset) > size
+      || (size - static_cast<std::size_t>(directoryOffset)) / DirectoryEntrySize < static_cast<std::size_t>(lumpCount))
+    throwInvalid(path, "corrupted directory");
+  m_lumpCount = lumpCount;
+  m_directory = data + directoryOffset;
+  // the lookups scan the directory from its end
+  m_file.advise(MappedFile::Access::Random);
+}
+
+Wad::Lump Wad::findLump(std::string_view name) const {
+  if (name.size() > LumpNameSize)
+    return {};
+  char key[LumpNameSize]{};
+  std::transform(name.begin(), name.end(), key, [](char c) { return static_cast<char>(std::toupper(static_cast<unsigned char>(c))); });
+
+  for (auto i = m_lumpCount - 1; i >= 0; --i) {
+    const auto entry = m_directory + static_cast<std::size_t>(i) * DirectoryEntrySize;
+    // names shorter than 8 characters are padded with zeros, some tools leave garbage after the first one
+    auto match = true;
+    for (std::size_t c = 0; c < LumpNameSize && match; ++c) {
+      const auto ch = static_cast<char>(std::toupper(entry[8 + c]));
+      match = ch == key[c];
+      if (key[c] == 0)
+        break;
+    }
+    if (!match)
+      continue;
+
+    const auto offset = readInt32(entry);
+    const auto size = readInt32(entry + 4);
+    if (offset < 0 || size < 0 || static_cast<std::size_t>(offset) > m_file.size()
+        || m_file.size() - static_cast<std::size_t>(offset) < static_cast<std::size_t>(size))
+      throwInvalid(m_path, "lump out of the file");
+    return {m_file.data() + offset, static_cast<std::size_t>(size)};
+  }
+  return {};
+}
+
+WadPalettes::WadPalettes(const Wad &wad) : m_wad(wad) {
+}
+
+int WadPalettes::getPaletteCount() {
+  findLumps();
+  return static_cast<int>(m_playpal.size / PaletteSize);
+}
+
+int WadPalettes::getLightLevelCount() {
+  findLumps();
+  return static_cast<int>(m_colormap.size / ColormapSize);
+}
+
+void WadPalettes::findLumps() {
+  if (!m_lumpsFound) {
+    m_playpal = m_wad.findLump("PLAYPAL");
+    m_colormap = m_wad.findLump("COLORMAP");
+    m_lumpsFound = true;
+  }
+}
+
+const std::uint8_t *WadPalettes::getPaletteData(int palette) {
+  findLumps();
+  if (palette < 0 || static_cast<std::size_t>(palette) >= m_playpal.size / PaletteSize) {
+    std::ostringstream ss;
+    ss << m_wad.getPath() << " has no palette " << palette;
+    throw std::runtime_error(ss.str());
+  }
+  return m_playpal.data + static_cast<std::size_t>(palette) * PaletteSize;
+}
+
+const std::uint8_t *WadPalettes::getColormap(int lightLevel) {
+  findLumps();
+  if (lightLevel == 0 && !m_colormap)
+    return nullptr;
+  if (lightLevel < 0 || static_cast<std::size_t>(lightLevel) >= m_colormap.size / ColormapSize) {
+    std::ostringstream ss;
+    ss << m_wad.getPath() << " has no light level " << lightLevel;
+    throw std::runtime_error(ss.str());
+  }
+  return m_colormap.data + static_cast<std::size_t>(lightLevel) * ColormapSize;
+}
+
+std::vector<std::uint8_t> WadPalettes::getPalette(int palette) {
+  const auto colors = getPaletteData(palette);
+  return {colors, colors + PaletteSize};
+}
+
+std::vector<std::uint8_t> WadPalettes::getLightRamp(int palette, int lightLevel) {
+  const auto colors = getPaletteData(palette);
+  const auto colormap = getColormap(lightLevel);
+  std::vector<std::uint8_t> ramp(PaletteSize);
+  for (auto i = 0; i < NumColors; ++i) {
+    const auto index = colormap ? colormap[i] : i;
+    std::memcpy(&ramp[static_cast<std::size_t>(i) * 3], colors + index * 3, 3);
+  }
+  return ramp;
+}
+
+std::vector<std::uint8_t> WadPalettes::getFireRamp(int palette, int lightLevel, const std::uint8_t *reference,
+                                                   int numColors) {
+  const auto colors = getPaletteData(palette);
+  const auto colormap = getColormap(lightLevel);
+  numColors = std::clamp(numColors, 0, NumColors);
+
+  if (m_reference != reference || m_referenceIndices.size() != static_cast<std::size_t>(numColors)) {
+    const auto normal = getPaletteData(0);
+    m_referenceIndices.resize(static_cast<std::size_t>(numColors));
+    for (auto i = 0; i < numColors; ++i) {
+      auto bestIndex = 0;
+      auto bestDistance = INT32_MAX;
+      for (auto j = 0; j < NumColors; ++j) {
+        auto distance = 0;
+        for (auto c = 0; c < 3; ++c) {
+          const auto delta = static_cast<int>(reference[i * 3 + c]) - normal[j * 3 + c];
+          distance += delta * delta;
+        }
+        if (distance < bestDistance) {
+          bestDistance = distance;
+          bestIndex = j;
+        }
+      }
+      m_referenceIndices[static_cast<std::size_t>(i)] = static_cast<std::uint8_t>(bestIndex);
+    }
+    m_reference = reference;
+  }
+
+  std::vector<std::uint8_t> ramp(static_cast<std::size_t>(numColors) * 3);
+  for (auto i = 0; i < numColors; ++i) {
+    auto index = m_referenceIndices[static_cast<std::size_t>(i)];
+    if (colormap) {
+      index = colormap[index];
+    }
+    std::memcpy(&ramp[static_cast<std::size_t>(i) * 3], colors + index * 3, 3);
+  }
+  return ramp;
+}
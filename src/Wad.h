@@ -0,0 +1,85 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "MappedFile.h"
+
+/// Doom WAD file (IWAD or PWAD): a directory of named lumps.
+///
+/// The file is mapped and the directory is searched where it lies in the mapping: opening a WAD of any size reads its
+/// header only, a lump costs the pages of the directory scanned and of its data when they are read.
+class Wad {
+public:
+  struct Lump {
+    const std::uint8_t *data{nullptr};
+    std::size_t size{0};
+
+    explicit operator bool() const noexcept { return data != nullptr; }
+  };
+
+  /// \param path: Specifies the WAD to open, an exception is thrown when it is not one.
+  explicit Wad(const std::string &path);
+
+  /// Finds a lump by name, the last one of the directory like the engine does, so a PWAD replaces the lumps it merges.
+  /// \param name: Specifies the name, at most 8 characters, compared without case.
+  /// \return the lump, empty when there is none of that name.
+  [[nodiscard]] Lump findLump(std::string_view name) const;
+
+  [[nodiscard]] bool isIwad() const noexcept { return m_iwad; }
+  [[nodiscard]] int getLumpCount() const noexcept { return m_lumpCount; }
+  [[nodiscard]] const std::string &getPath() const noexcept { return m_path; }
+
+private:
+  std::string m_path;
+  MappedFile m_file;
+  bool m_iwad{false};
+  int m_lumpCount{0};
+  const std::uint8_t *m_directory{nullptr};
+};
+
+/// Fire palettes sourced from the PLAYPAL and COLORMAP lumps of a WAD, read on first use.
+///
+/// PLAYPAL holds the 256-color palettes of the game (0 the normal one, then the damage, pickup and radiation suit
+/// tints), COLORMAP the 256-index light ramps, from full bright to black. A fire ramp maps each color of a reference
+/// palette to the closest index of the normal palette, darkens it through a light ramp, then takes its color from
+/// the palette asked for: the fire follows a PWAD recoloring the game and its tints.
+class WadPalettes {
+public:
+  static constexpr int NumColors = 256;
+
+  /// \param wad: Specifies the WAD to read the lumps from, it must outlive this object.
+  explicit WadPalettes(const Wad &wad);
+
+  /// Returns the number of palettes of PLAYPAL, 0 when the WAD has none.
+  int getPaletteCount();
+  /// Returns the number of light ramps of COLORMAP, 0 when the WAD has none.
+  int getLightLevelCount();
+
+  /// Returns the colors of a PLAYPAL palette as RGB triplets, an exception is thrown when it does not exist.
+  std::vector<std::uint8_t> getPalette(int palette);
+  /// Returns the colors of a PLAYPAL palette seen through a light ramp of COLORMAP, as RGB triplets.
+  /// \param lightLevel: Specifies the light ramp, 0 is full bright; the WAD colors are used as they are without COLORMAP.
+  std::vector<std::uint8_t> getLightRamp(int palette, int lightLevel);
+  /// Returns a fire palette of the colors of the WAD, as RGB triplets.
+  /// \param palette: Specifies the PLAYPAL palette the colors are taken from.
+  /// \param lightLevel: Specifies the light ramp darkening the fire, 0 is full bright.
+  /// \param reference: Specifies the colors the ramp imitates, the closest colors of the normal palette are used.
+  /// \param numColors: Specifies the number of colors of the reference.
+  std::vector<std::uint8_t> getFireRamp(int palette, int lightLevel, const std::uint8_t *reference, int numColors);
+
+private:
+  void findLumps();
+  const std::uint8_t *getPaletteData(int palette);
+  const std::uint8_t *getColormap(int lightLevel);
+
+private:
+  const Wad &m_wad;
+  bool m_lumpsFound{false};
+  Wad::Lump m_playpal;
+  Wad::Lump m_colormap;
+  // indices of the normal palette closest to the last reference
+  const std::uint8_t *m_reference{nullptr};
+  std::vector<std::uint8_t> m_referenceIndices;
+};
@@ -1,21 +1,45 @@
 #include "Window.h"
+#include "Debug.h"
+#include "GlCapabilities.h"
+#include "RenderTarget.h"
+#include "ShaderCache.h"
 #include <GL/glew.h>
 #include <SDL.h>
+#include <algorithm>
 #include <imgui.h>
 #include <imgui/examples/imgui_impl_opengl3.h>
 #include <imgui/examples/imgui_impl_sdl.h>
 #include <iostream>
 #include <sstream>
+#ifdef USE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cstring>
+#endif
 
 Window::Window() = default;
 
-void Window::init() {
-  if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER | SDL_INIT_GAMECONTROLLER) != 0) {
+void Window::init(const WindowSettings &settings) {
+  m_settings = settings;
+  if (m_settings.software) {
+    initSoftware();
+  } else if (m_settings.headless) {
+    initHeadless();
+  } else {
+    initWindow();
+  }
+}
+
+void Window::initSdl(Uint32 flags) {
+  if (SDL_Init(flags) != 0) {
     std::ostringstream ss;
     ss << "Error when initializing SDL (error=" << SDL_GetError() << ")";
     throw std::runtime_error(ss.str());
   }
 
+  if (!(flags & SDL_INIT_GAMECONTROLLER))
+    return;
+
   //Check for joysticks
   if (SDL_NumJoysticks() < 1) {
     std::cout << "Warning: No joysticks connected!\n";
@@ -26,21 +50,30 @@ void Window::init() {
       std::cout << "Warning: Unable to open game controller! SDL Error: " << SDL_GetError() << "\n";
     }
   }
+}
+
+void Window::initWindow() {
+  initSdl(SDL_INIT_VIDEO | SDL_INIT_TIMER | SDL_INIT_GAMECONTROLLER);
+
+#ifdef USE_GL_DEBUG_OUTPUT
+  // some drivers only emit debug messages in a debug context
+  const int ContextDebugFlag = SDL_GL_CONTEXT_DEBUG_FLAG;
+#else
+  const int ContextDebugFlag = 0;
+#endif
 
   // Decide GL+GLSL versions
 #if __APPLE__
   // GL 3.2 Core + GLSL 150
-  const char *glsl_version = "#version 150";
   SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS,
-                      SDL_GL_CONTEXT_FORWARD_COMPATIBLE_FLAG);// Always required on Mac
+                      SDL_GL_CONTEXT_FORWARD_COMPATIBLE_FLAG | ContextDebugFlag);// Always required on Mac
   SDL_GL_SetAttribute(
       SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
   SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
   SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
 #else
   // GL 3.0 + GLSL 130
-  const char *glsl_version = "#version 130";
-  SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, 0);
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, ContextDebugFlag);
   SDL_GL_SetAttribute(
       SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
   SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
@@ -54,7 +87,7 @@ void Window::init() {
   auto window_flags = (SDL_WindowFlags) (
       SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI);
   m_window = SDL_CreateWindow("SDL/OpenGL Doom Fire", SDL_WINDOWPOS_CENTERED,
-                              SDL_WINDOWPOS_CENTERED, 1280, 720, window_flags);
+                              SDL_WINDOWPOS_CENTERED, m_settings.width, m_settings.height, window_flags);
 
   // setup OpenGL
   m_glContext = SDL_GL_CreateContext(m_window);
@@ -67,6 +100,112 @@ void Window::init() {
   SDL_GL_MakeCurrent(m_window, m_glContext);
   SDL_GL_SetSwapInterval(1);
 
+  initGl();
+}
+
+void Window::initHeadless() {
+#ifdef USE_EGL
+  // SDL only provides the timer and the quit event on Ctrl+C
+  initSdl(SDL_INIT_TIMER | SDL_INIT_EVENTS);
+
+  // the surfaceless platform needs neither X11 nor Wayland, EGL_DEFAULT_DISPLAY is the fallback
+  EGLDisplay display = EGL_NO_DISPLAY;
+  const char *clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+  auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+  if (clientExtensions && std::strstr(clientExtensions, "EGL_MESA_platform_surfaceless") && getPlatformDisplay) {
+    display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+  }
+  if (display == EGL_NO_DISPLAY) {
+    display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  }
+  if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+    std::ostringstream ss;
+    ss << "Error when initializing EGL (error=0x" << std::hex << eglGetError() << ")";
+    throw std::runtime_error(ss.str());
+  }
+  m_eglDisplay = display;
+
+  if (!eglBindAPI(EGL_OPENGL_API)) {
+    throw std::runtime_error("Error when initializing EGL: desktop OpenGL is not supported");
+  }
+
+  // without surfaceless contexts a small pbuffer makes the context current, the drawing goes to a framebuffer object anyway
+  const char *extensions = eglQueryString(display, EGL_EXTENSIONS);
+  const bool surfaceless = extensions && std::strstr(extensions, "EGL_KHR_surfaceless_context");
+  const EGLint configAttributes[]{
+      EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+      EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+      EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+      EGL_NONE};
+  EGLConfig config = nullptr;
+  EGLint numConfigs = 0;
+  if (!eglChooseConfig(display, configAttributes, &config, 1, &numConfigs) || numConfigs == 0) {
+    throw std::runtime_error("Error when initializing EGL: no OpenGL config");
+  }
+
+  const EGLint contextAttributes[]{
+      EGL_CONTEXT_MAJOR_VERSION, 3,
+      EGL_CONTEXT_MINOR_VERSION, 3,
+      EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+#ifdef USE_GL_DEBUG_OUTPUT
+      EGL_CONTEXT_OPENGL_DEBUG, EGL_TRUE,
+#endif
+      EGL_NONE};
+  m_eglContext = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+  if (m_eglContext == EGL_NO_CONTEXT) {
+    std::ostringstream ss;
+    ss << "Error when creating GL context (error=0x" << std::hex << eglGetError() << ")";
+    throw std::runtime_error(ss.str());
+  }
+
+  EGLSurface surface = EGL_NO_SURFACE;
+  if (!surfaceless) {
+    const EGLint surfaceAttributes[]{EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+    surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+    m_eglSurface = surface;
+  }
+  if (!eglMakeCurrent(display, surface, surface, m_eglContext)) {
+    std::ostringstream ss;
+    ss << "Error when making the GL context current (error=0x" << std::hex << eglGetError() << ")";
+    throw std::runtime_error(ss.str());
+  }
+
+  initGl();
+
+  m_offscreen = std::make_unique<RenderTarget>(m_settings.width, m_settings.height);
+  m_offscreen->setLabel("headless framebuffer");
+  m_lastFrameCounter = SDL_GetPerformanceCounter();
+#else
+  throw std::runtime_error("Headless rendering needs a build with EGL (DOOMFIRE_EGL)");
+#endif
+}
+
+void Window::initSoftware() {
+  if (m_settings.headless) {
+    initSdl(SDL_INIT_TIMER | SDL_INIT_EVENTS);
+    return;
+  }
+
+  initSdl(SDL_INIT_VIDEO | SDL_INIT_TIMER | SDL_INIT_GAMECONTROLLER);
+  auto window_flags = (SDL_WindowFlags) (SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI);
+  m_window = SDL_CreateWindow("SDL Doom Fire (software)", SDL_WINDOWPOS_CENTERED,
+                              SDL_WINDOWPOS_CENTERED, m_settings.width, m_settings.height, window_flags);
+  if (!m_window) {
+    std::ostringstream ss;
+    ss << "Error when creating the window (error=" << SDL_GetError() << ")";
+    throw std::runtime_error(ss.str());
+  }
+
+  // the software renderer is asked explicitly, the default one would often be OpenGL
+  m_renderer = SDL_CreateRenderer(m_window, -1, SDL_RENDERER_SOFTWARE);
+  if (!m_renderer) {
+    std::ostringstream ss;
+    ss << "Error when creating the software renderer (error=" << SDL_GetError() << ")";
+    throw std::runtime_error(ss.str());
+  }
+}
+
+void Window::initGl() {
   auto err = glGetError();
   if (err != GL_NO_ERROR) {
     std::ostringstream ss;
@@ -75,11 +214,24 @@ void Window::init() {
   };
 
   err = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+  // a GLX build of GLEW loads the GL entry points before looking for an X display, they work with EGL contexts
+  if (m_settings.headless && err == GLEW_ERROR_NO_GLX_DISPLAY) {
+    err = GLEW_OK;
+  }
+#endif
   if (err != GLEW_OK) {
     std::ostringstream ss;
     ss << "Error when initializing glew " << glewGetErrorString(err);
     throw std::runtime_error(ss.str());
   }
+  GlCapabilities::detect();
+  installDebugOutput();
+
+  if (auto prefPath = SDL_GetPrefPath("DoomFire", "shaders")) {
+    ShaderCache::get().setDirectory(prefPath);
+    SDL_free(prefPath);
+  }
 
   // Setup Dear ImGui context
   IMGUI_CHECKVERSION();
@@ -91,27 +243,97 @@ void Window::init() {
   // Setup Platform/Renderer bindings
   // window is the SDL_Window*
   // contex is the SDL_GLContext
-  ImGui_ImplSDL2_InitForOpenGL(m_window, m_glContext);
-  ImGui_ImplOpenGL3_Init(glsl_version);
+  if (m_window) {
+    ImGui_ImplSDL2_InitForOpenGL(m_window, m_glContext);
+  }
+#if __APPLE__
+  ImGui_ImplOpenGL3_Init("#version 150");
+#else
+  ImGui_ImplOpenGL3_Init("#version 130");
+#endif
 }
 
 void Window::display() {
-  SDL_GL_SwapWindow(m_window);
+  if (m_settings.software) {
+    if (m_renderer) {
+      SDL_RenderPresent(m_renderer);
+    }
+    return;
+  }
+  if (m_window) {
+    SDL_GL_SwapWindow(m_window);
+    return;
+  }
+  // nothing is presented, flushing keeps the GPU busy while the next frame is recorded
+  GL_CHECK(glFlush());
 }
 
 bool Window::pollEvent(SDL_Event &event) {
   return SDL_PollEvent(&event);
 }
 
+void Window::newImGuiFrame() {
+  if (m_window) {
+    ImGui_ImplSDL2_NewFrame(m_window);
+    return;
+  }
+
+  // what the SDL binding does, without a window nor inputs
+  auto &io = ImGui::GetIO();
+  io.DisplaySize = ImVec2(static_cast<float>(m_settings.width), static_cast<float>(m_settings.height));
+  io.DisplayFramebufferScale = ImVec2(1, 1);
+  const auto counter = SDL_GetPerformanceCounter();
+  io.DeltaTime = std::max(static_cast<float>(counter - m_lastFrameCounter) / static_cast<float>(SDL_GetPerformanceFrequency()), 1e-6f);
+  m_lastFrameCounter = counter;
+}
+
+void Window::getDrawableSize(int &width, int &height) const {
+  if (m_renderer) {
+    SDL_GetRendererOutputSize(m_renderer, &width, &height);
+    return;
+  }
+  if (m_window) {
+    SDL_GL_GetDrawableSize(m_window, &width, &height);
+    return;
+  }
+  width = m_settings.width;
+  height = m_settings.height;
+}
+
+unsigned int Window::getFramebuffer() const {
+  return m_offscreen ? m_offscreen->getHandle() : 0;
+}
+
 Window::~Window() {
   //Close game controller
   SDL_GameControllerClose(m_gameController);
   m_gameController = nullptr;
 
-  ImGui_ImplOpenGL3_Shutdown();
-  ImGui_ImplSDL2_Shutdown();
-  ImGui::DestroyContext();
+  if (!m_settings.software) {
+    ImGui_ImplOpenGL3_Shutdown();
+    if (m_window) {
+      ImGui_ImplSDL2_Shutdown();
+    }
+    ImGui::DestroyContext();
+  }
 
+  m_offscreen.reset();
+#ifdef USE_EGL
+  if (m_eglDisplay) {
+    eglMakeCurrent(m_eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (m_eglSurface) {
+      eglDestroySurface(m_eglDisplay, m_eglSurface);
+    }
+    if (m_eglContext) {
+      eglDestroyContext(m_eglDisplay, m_eglContext);
+    }
+    eglTerminate(m_eglDisplay);
+  }
+#endif
+
+  if (m_renderer) {
+    SDL_DestroyRenderer(m_renderer);
+  }
   SDL_GL_DeleteContext(m_glContext);
   SDL_DestroyWindow(m_window);
   SDL_Quit();
@@ -1,25 +1,80 @@
 #ifndef COLORCYCLING__WINDOW_H
 #define COLORCYCLING__WINDOW_H
 
+#include <memory>
 #include <SDL.h>
 
+class RenderTarget;
+
+struct WindowSettings {
+  /// Renders into an offscreen framebuffer of an EGL context instead of an SDL window,
+  /// no display server is needed (Mesa llvmpipe works).
+  bool headless{false};
+  /// Presents through an SDL software renderer instead of an OpenGL context, no GL function is called.
+  /// Combined with headless, nothing is shown and the images are only expanded in memory.
+  bool software{false};
+  int width{1280};
+  int height{720};
+};
+
 class Window {
 public:
   Window();
   ~Window();
 
-  void init();
+  void init(const WindowSettings &settings = {});
   void display();
   bool pollEvent(SDL_Event &event);
+  /// Starts the platform side of an ImGui frame.
+  void newImGuiFrame();
 
+  /// Returns the SDL window, nullptr when headless.
   SDL_Window *getNativeHandle() {
     return m_window;
   }
 
+  /// Returns the software renderer of the window, nullptr without one.
+  SDL_Renderer *getRenderer() {
+    return m_renderer;
+  }
+
+  [[nodiscard]] bool isHeadless() const noexcept {
+    return m_settings.headless;
+  }
+
+  /// Returns true when there is no OpenGL context, nor ImGui.
+  [[nodiscard]] bool isSoftware() const noexcept {
+    return m_settings.software;
+  }
+
+  /// Returns the size in pixels of the framebuffer the application draws to.
+  void getDrawableSize(int &width, int &height) const;
+  /// Returns the framebuffer the application draws to: 0 for a window, the offscreen framebuffer when headless.
+  [[nodiscard]] unsigned int getFramebuffer() const;
+  /// Returns the offscreen target when headless, nullptr otherwise.
+  [[nodiscard]] const RenderTarget *getOffscreenTarget() const noexcept {
+    return m_offscreen.get();
+  }
+
+private:
+  void initSdl(Uint32 flags);
+  void initWindow();
+  void initSoftware();
+  void initHeadless();
+  void initGl();
+
 private:
+  WindowSettings m_settings;
   SDL_Window *m_window{nullptr};
+  SDL_Renderer *m_renderer{nullptr};
   SDL_GameController *m_gameController{nullptr};
   SDL_GLContext m_glContext{nullptr};
+  // EGL objects of the headless context, kept opaque so that EGL headers stay out of this file
+  void *m_eglDisplay{nullptr};
+  void *m_eglContext{nullptr};
+  void *m_eglSurface{nullptr};
+  std::unique_ptr<RenderTarget> m_offscreen;
+  Uint64 m_lastFrameCounter{0};
 };
 
 #endif//COLORCYCLING__WINDOW_H
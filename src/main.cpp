@@ -1,7 +1,233 @@
 #include "DoomFireApplication.h"
+#include "FirePalette.h"
+#include "PaletteExpander.h"
+#include "ShardedFireSimulation.h"
+#include "SoftwareFireApplication.h"
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string_view>
+#include <vector>
 
-int main() {
-  DoomFireApplication app;
-  app.run();
+namespace {
+void printUsage(const char *program) {
+  std::cerr << "Usage: " << program << " [--headless] [--software] [--size WIDTHxHEIGHT] [--frames N]\n"
+            << "       [--stream-out PATH] [--stream-format y4m|rgba|indexed] [--stream-drop] [--record PATH] [--play PATH]\n"
+            << "       [--load-snapshot PATH] [--save-snapshot PATH] [--frame-bus NAME] [--fire-size WIDTHxHEIGHT] [--shards N]\n"
+            << "       [--wad PATH] [--wad-palette N] [--wad-light N] [--terminal] [--terminal-fps N]\n"
+            << "       [--bench-expand] [--bench-shards]\n"
+            << "  --headless  render offscreen through EGL, no display server needed\n"
+            << "  --software  expand the palette on the CPU and present through SDL, without OpenGL\n"
+            << "  --size      size of the window or of the offscreen framebuffer (default 1280x720)\n"
+            << "  --frames    quit after rendering N frames and print the average frame time\n"
+            << "  --stream-out     write every simulation tick of the CPU fire to a file, a FIFO or - for stdout,\n"
+            << "                   e.g. --stream-out - | ffmpeg -i - fire.mp4\n"
+            << "  --stream-format  y4m (default), rgba or indexed, the raw formats have no header\n"
+            << "  --stream-drop    skip frames when the reader is late instead of waiting for it\n"
+            << "  --record    write every simulation tick to a session recording (keyframes and compressed deltas)\n"
+            << "  --play      play a session recording back instead of running the simulation\n"
+            << "  --load-snapshot  start from a saved state of the simulation instead of a blank grid\n"
+            << "  --save-snapshot  save the state of the simulation when quitting\n"
+            << "  --frame-bus      publish every simulation tick to a shared memory object, e.g. /doom_fire,\n"
+            << "                   for other processes to read in place (see examples/FrameBusReaderExample.cpp)\n"
+            << "  --fire-size  size of the fire of the software path (default 640x480)\n"
+            << "  --shards     simulate the fire of the software path in N processes, each owning a slice of columns\n"
+            << "  --wad          take the fire colors from the PLAYPAL and COLORMAP lumps of a Doom WAD\n"
+            << "  --wad-palette  PLAYPAL palette of the WAD: 0 normal, 1-8 damage, 9-12 pickup, 13 radiation suit\n"
+            << "  --wad-light    COLORMAP light level darkening the fire, 0 (default) is full bright\n"
+            << "  --terminal     draw the fire in the terminal with 24-bit colors, no display nor OpenGL needed\n"
+            << "  --terminal-fps frames drawn per second at most in the terminal (default 30)\n"
+            << "  --bench-expand  measure the palette expansion kernels in GB/s of RGBA written, then quit\n"
+            << "  --bench-shards  measure a video wall sized fire simulated by 1 to 16 processes, then quit\n";
+}
+
+void benchmarkExpansion() {
+  constexpr int Width = 640;
+  constexpr int Height = 480;
+  constexpr int NumImages = 200;
+  // a burning fire rather than uniform indices, the lookups see the real distribution
+  FireSimulation fire(Width, Height);
+  for (auto i = 0; i < 100; ++i) {
+    fire.update();
+  }
+
+  PaletteExpander expander(FirePalette::Colors, FirePalette::NumColors);
+  for (auto kernel : {PaletteExpander::Kernel::Scalar, PaletteExpander::Kernel::Ssse3, PaletteExpander::Kernel::Avx2,
+                      PaletteExpander::Kernel::Neon}) {
+    if (!PaletteExpander::isSupported(kernel))
+      continue;
+    expander.setKernel(kernel);
+    std::cout << "Palette expansion " << PaletteExpander::getName(kernel) << ":";
+    for (auto scale : {1, 2, 3}) {
+      const auto pitch = static_cast<std::size_t>(Width) * scale * 4;
+      std::vector<std::uint8_t> pixels(pitch * Height * scale);
+      // warm up, then time a batch of images
+      expander.expand(fire.getImage(), Width, Height, scale, pixels.data(), pitch);
+      auto start = std::chrono::steady_clock::now();
+      for (auto i = 0; i < NumImages; ++i) {
+        expander.expand(fire.getImage(), Width, Height, scale, pixels.data(), pitch);
+      }
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      const auto bytes = static_cast<double>(pixels.size()) * NumImages;
+      std::cout << " x" << scale << " " << bytes / elapsed.count() / 1e9 << " GB/s ("
+                << elapsed.count() * 1000. / NumImages << " ms)";
+    }
+    std::cout << "\n";
+  }
+}
+
+void benchmarkShards() {
+  constexpr int Width = 16384;
+  constexpr int Height = 1080;
+  constexpr int NumTicks = 20;
+  FireSimulation fire(Width, Height);
+  for (auto i = 0; i < 50; ++i) {
+    fire.update();
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (auto i = 0; i < NumTicks; ++i) {
+    fire.update();
+  }
+  std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+  std::cout << "Fire of " << Width << "x" << Height << ": 1 process " << elapsed.count() / NumTicks << " ms/tick\n";
+
+  for (auto shardCount : {2, 4, 8, 16}) {
+    ShardedFireSimulation shards(fire.getImage(), Width, Height, shardCount);
+    shards.update();
+    start = std::chrono::steady_clock::now();
+    for (auto i = 0; i < NumTicks; ++i) {
+      shards.update();
+    }
+    elapsed = std::chrono::steady_clock::now() - start;
+    const auto &stats = shards.getStats();
+    const auto ticks = static_cast<double>(stats.ticks);
+    std::cout << "Fire of " << Width << "x" << Height << ": " << shardCount << " processes "
+              << elapsed.count() / NumTicks << " ms/tick (slowest sweep " << stats.sweepTime / ticks
+              << " ms, halo exchange " << stats.exchangeTime / ticks << " ms)\n";
+  }
+}
+
+bool parseArguments(int argc, char **argv, ApplicationSettings &settings) {
+  for (auto i = 1; i < argc; ++i) {
+    std::string_view arg(argv[i]);
+    if (arg == "--headless") {
+      settings.window.headless = true;
+    } else if (arg == "--software") {
+      settings.window.software = true;
+    } else if (arg == "--size" && i + 1 < argc) {
+      if (std::sscanf(argv[++i], "%dx%d", &settings.window.width, &settings.window.height) != 2
+          || settings.window.width <= 0 || settings.window.height <= 0)
+        return false;
+    } else if (arg == "--stream-out" && i + 1 < argc) {
+      settings.stream.path = argv[++i];
+    } else if (arg == "--stream-format" && i + 1 < argc) {
+      std::string_view format(argv[++i]);
+      if (format == "y4m") {
+        settings.stream.format = StreamFormat::Y4m;
+      } else if (format == "rgba") {
+        settings.stream.format = StreamFormat::Rgba;
+      } else if (format == "indexed") {
+        settings.stream.format = StreamFormat::Indexed;
+      } else {
+        return false;
+      }
+    } else if (arg == "--record" && i + 1 < argc) {
+      settings.record = argv[++i];
+    } else if (arg == "--play" && i + 1 < argc) {
+      settings.play = argv[++i];
+    } else if (arg == "--load-snapshot" && i + 1 < argc) {
+      settings.loadSnapshot = argv[++i];
+    } else if (arg == "--save-snapshot" && i + 1 < argc) {
+      settings.saveSnapshot = argv[++i];
+    } else if (arg == "--fire-size" && i + 1 < argc) {
+      if (std::sscanf(argv[++i], "%dx%d", &settings.fireWidth, &settings.fireHeight) != 2 || settings.fireWidth < 2
+          || settings.fireHeight < 2)
+        return false;
+    } else if (arg == "--shards" && i + 1 < argc) {
+      settings.shards = std::atoi(argv[++i]);
+      if (settings.shards <= 0)
+        return false;
+    } else if (arg == "--wad" && i + 1 < argc) {
+      settings.wad = argv[++i];
+    } else if (arg == "--wad-palette" && i + 1 < argc) {
+      settings.wadPalette = std::atoi(argv[++i]);
+    } else if (arg == "--wad-light" && i + 1 < argc) {
+      settings.wadLightLevel = std::atoi(argv[++i]);
+    } else if (arg == "--terminal") {
+      settings.terminal = true;
+      settings.window.software = true;
+      settings.window.headless = true;
+    } else if (arg == "--terminal-fps" && i + 1 < argc) {
+      settings.terminalFps = std::atoi(argv[++i]);
+      if (settings.terminalFps <= 0)
+        return false;
+    } else if (arg == "--frame-bus" && i + 1 < argc) {
+      settings.frameBus = argv[++i];
+    } else if (arg == "--stream-drop") {
+      settings.stream.policy = StreamPolicy::Drop;
+    } else if (arg == "--frames" && i + 1 < argc) {
+      settings.frames = std::atoi(argv[++i]);
+      if (settings.frames <= 0)
+        return false;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+}// namespace
+
+int main(int argc, char **argv) {
+  if (argc == 2 && std::string_view(argv[1]) == "--bench-expand") {
+    benchmarkExpansion();
+    return EXIT_SUCCESS;
+  }
+  if (argc == 2 && std::string_view(argv[1]) == "--bench-shards") {
+    try {
+      benchmarkShards();
+    } catch (const std::exception &e) {
+      std::cerr << e.what() << '\n';
+      return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+  }
+
+  ApplicationSettings settings;
+  if (!parseArguments(argc, argv, settings)) {
+    printUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (settings.shards > 0 && (!settings.loadSnapshot.empty() || !settings.saveSnapshot.empty())) {
+    // a snapshot holds the random generator of one simulation, the shards each have theirs
+    std::cerr << "--shards cannot be combined with --load-snapshot or --save-snapshot\n";
+    return EXIT_FAILURE;
+  }
+
+  if (settings.terminal) {
+    // the fire owns the terminal, the messages go to the error output
+    std::cout.rdbuf(std::cerr.rdbuf());
+  }
+  if (!settings.stream.path.empty()) {
+#ifdef SIGPIPE
+    // a reader closing the pipe fails the writes instead of killing the process
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
+    if (settings.stream.path == "-") {
+      // the frames own the standard output, the messages go to the error output
+      std::cout.rdbuf(std::cerr.rdbuf());
+    }
+  }
+
+  std::unique_ptr<Application> app;
+  if (settings.window.software) {
+    app = std::make_unique<SoftwareFireApplication>(settings);
+  } else {
+    app = std::make_unique<DoomFireApplication>(settings);
+  }
+  app->run();
   return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
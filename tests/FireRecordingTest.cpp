@@ -0,0 +1,120 @@
+#include "FirePalette.h"
+#include "FireRecording.h"
+#include "FireSimulation.h"
+#include "TestCheck.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace {
+constexpr int Width = 160;
+constexpr int Height = 120;
+constexpr int FrameCount = 150;
+constexpr int KeyframeInterval = 20;
+constexpr std::size_t TrailerSize = 16;
+
+using TestCheck::check;
+
+bool isFrame(const FireRecordingPlayer &player, const std::vector<std::uint8_t> &frame) {
+  return std::memcmp(player.getImage(), frame.data(), frame.size()) == 0;
+}
+
+std::vector<std::vector<std::uint8_t>> record(const std::string &path) {
+  FireSimulation fire(Width, Height);
+  std::vector<std::vector<std::uint8_t>> frames;
+  FireRecordingWriter writer(path, Width, Height, FirePalette::Colors, FirePalette::NumColors, 60, KeyframeInterval);
+  for (auto i = 0; i < FrameCount; ++i) {
+    fire.update();
+    // a reset makes a delta as large as a keyframe
+    if (i == FrameCount / 2) {
+      fire.reset();
+    }
+    frames.emplace_back(fire.getImage(), fire.getImage() + static_cast<std::size_t>(Width) * Height);
+    writer.addFrame(fire.getImage(), Width, Height);
+  }
+  return frames;
+}
+
+void testRoundTrip(const std::string &path, const std::vector<std::vector<std::uint8_t>> &frames) {
+  FireRecordingPlayer player(path);
+  check(player.getWidth() == Width && player.getHeight() == Height, "size of the recording");
+  check(player.getFrameCount() == FrameCount, "number of frames of the index");
+  check(player.getKeyframeInterval() == KeyframeInterval, "keyframe interval");
+  check(player.getNumColors() == FirePalette::NumColors
+            && std::memcmp(player.getPalette(), FirePalette::Colors, FirePalette::NumColors * 3) == 0,
+        "palette of the recording");
+
+  auto played = true;
+  for (auto i = 0; i < FrameCount; ++i) {
+    player.next();
+    played = played && isFrame(player, frames[static_cast<std::size_t>(i)]);
+  }
+  check(played, "frames played in order");
+
+  auto sought = true;
+  auto maxDecoded = 0;
+  for (auto i = 0; i < FrameCount; ++i) {
+    const auto frame = i * 37 % FrameCount;
+    player.seek(frame);
+    sought = sought && isFrame(player, frames[static_cast<std::size_t>(frame)]);
+    maxDecoded = std::max(maxDecoded, player.getDecodedFrames());
+  }
+  check(sought, "frames sought out of order");
+  check(maxDecoded <= KeyframeInterval, "a seek decodes from the keyframe before the frame at most");
+}
+
+void testWithoutIndex(const std::string &path, const std::vector<std::vector<std::uint8_t>> &frames) {
+  // the index, the trailer and half of the last frame lost as when the writer is killed
+  const auto size = std::filesystem::file_size(path);
+  std::filesystem::resize_file(path, size - FrameCount * 8 - TrailerSize - 10);
+  FireRecordingPlayer player(path);
+  check(player.getFrameCount() == FrameCount - 1, "frames found without the index");
+  player.seek(FrameCount - 2);
+  check(isFrame(player, frames[FrameCount - 2]), "last complete frame without the index");
+}
+
+void testCorruptedTrailer(const std::string &path, const std::vector<std::vector<std::uint8_t>> &frames) {
+  // an index larger than the file, at an offset wrapping around with its size to the size of the file
+  const auto size = static_cast<std::uint64_t>(std::filesystem::file_size(path));
+  const std::uint32_t count = 0x10000000;
+  const auto indexOffset = size - TrailerSize - std::uint64_t{count} * 8;
+  std::uint8_t trailer[12];
+  for (auto i = 0; i < 8; ++i) {
+    trailer[i] = static_cast<std::uint8_t>(indexOffset >> (i * 8));
+  }
+  for (auto i = 0; i < 4; ++i) {
+    trailer[8 + i] = static_cast<std::uint8_t>(count >> (i * 8));
+  }
+  {
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(static_cast<std::streamoff>(size - TrailerSize));
+    file.write(reinterpret_cast<const char *>(trailer), sizeof(trailer));
+  }
+
+  FireRecordingPlayer player(path);
+  check(player.getFrameCount() == FrameCount, "the walk stops before the index");
+  auto played = true;
+  for (auto i = 0; i < player.getFrameCount(); ++i) {
+    player.seek(i);
+    played = played && i < FrameCount && isFrame(player, frames[static_cast<std::size_t>(i)]);
+  }
+  check(played, "frames found by walking the file when the trailer is corrupted");
+}
+}// namespace
+
+int main() {
+  const auto path = (std::filesystem::temp_directory_path() / "FireRecordingTest.dfr").string();
+  try {
+    auto frames = record(path);
+    testRoundTrip(path, frames);
+    testCorruptedTrailer(path, frames);
+    frames = record(path);
+    testWithoutIndex(path, frames);
+  } catch (const std::exception &e) {
+    TestCheck::fail(e.what());
+  }
+  std::filesystem::remove(path);
+  return TestCheck::getResult();
+}
@@ -0,0 +1,76 @@
+#include "FireSimulation.h"
+#include "FireSnapshot.h"
+#include "TestCheck.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace {
+constexpr int Width = 160;
+constexpr int Height = 120;
+
+using TestCheck::check;
+
+void testRoundTrip(const std::string &path) {
+  FireSimulation saved(Width, Height);
+  for (auto tick = 0; tick < 300; ++tick) {
+    saved.update();
+  }
+  FireSnapshot::save(saved, path);
+
+  // a simulation of another size and seed takes the state of the snapshot
+  FireSimulation restored(32, 20, 5);
+  FireSnapshot::load(restored, path);
+  check(restored.getWidth() == Width && restored.getHeight() == Height, "size of the snapshot");
+  check(restored.getTick() == saved.getTick(), "tick of the snapshot");
+  check(restored.getRandomState() == saved.getRandomState(), "random state of the snapshot");
+
+  auto same = true;
+  for (auto tick = 0; tick < 100; ++tick) {
+    saved.update();
+    restored.update();
+    same = same && std::memcmp(saved.getImage(), restored.getImage(), static_cast<std::size_t>(Width) * Height) == 0;
+  }
+  check(same, "the restored simulation ticks as the saved one");
+}
+
+void testInvalid(const std::string &path) {
+  auto throws = [](const std::string &snapshot) {
+    FireSimulation fire(Width, Height);
+    try {
+      FireSnapshot::load(fire, snapshot);
+    } catch (const std::exception &) {
+      return fire.getWidth() == Width && fire.getHeight() == Height;
+    }
+    return false;
+  };
+  check(throws(path + ".missing"), "a missing snapshot throws");
+
+  // the header of a valid snapshot without its image
+  {
+    FireSimulation fire(Width, Height);
+    FireSnapshot::save(fire, path);
+  }
+  std::filesystem::resize_file(path, sizeof(FireSnapshot::Header) + 10);
+  check(throws(path), "a truncated snapshot throws and leaves the simulation as it was");
+
+  {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << "not a snapshot of the fire, but long enough to hold a header";
+  }
+  check(throws(path), "a file of another kind throws");
+}
+}// namespace
+
+int main() {
+  const auto path = (std::filesystem::temp_directory_path() / "FireSnapshotTest.dfs").string();
+  try {
+    testRoundTrip(path);
+    testInvalid(path);
+  } catch (const std::exception &e) {
+    TestCheck::fail(e.what());
+  }
+  std::filesystem::remove(path);
+  return TestCheck::getResult();
+}
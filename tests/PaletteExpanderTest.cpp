@@ -0,0 +1,73 @@
+#include "PaletteExpander.h"
+#include "TestCheck.h"
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+using TestCheck::check;
+
+// vector sized palettes, one quarter of the tables partly filled, and table sized ones
+constexpr int ColorCounts[]{1, 16, 17, 37, 63, 64, 65, 200, 256};
+// the vector kernels expand 16 or 32 pixels at a time, the rest goes through the scalar tail
+constexpr int Widths[]{1, 7, 15, 17, 31, 33, 63, 65, 257, 301};
+constexpr int Height = 3;
+constexpr int MaxScale = 5;
+
+std::vector<std::uint8_t> expand(const PaletteExpander &expander, const std::vector<std::uint8_t> &indices, int width,
+                                 int scale) {
+  // a pitch wider than the rows: the pixels past them must stay untouched
+  const auto pitch = static_cast<std::size_t>(width) * scale * 4 + 12;
+  std::vector<std::uint8_t> pixels(pitch * Height * scale, 0xCD);
+  expander.expand(indices.data(), width, Height, scale, pixels.data(), pitch);
+  return pixels;
+}
+
+void testKernel(PaletteExpander::Kernel kernel) {
+  std::mt19937 random(1);
+  std::vector<std::uint8_t> palette(256 * 3);
+  for (auto &value : palette) {
+    value = static_cast<std::uint8_t>(random());
+  }
+
+  PaletteExpander scalar(palette.data(), 1);
+  scalar.setKernel(PaletteExpander::Kernel::Scalar);
+  PaletteExpander vector(palette.data(), 1);
+  vector.setKernel(kernel);
+  check(vector.getKernel() == kernel, "a supported kernel is selected");
+
+  const auto what = std::string(PaletteExpander::getName(kernel)) + " kernel expands like the scalar one";
+  auto same = true;
+  for (auto numColors : ColorCounts) {
+    scalar.setPalette(palette.data(), numColors);
+    vector.setPalette(palette.data(), numColors);
+    for (auto width : Widths) {
+      // indices past the end of the palette too, they are expanded to black
+      std::vector<std::uint8_t> indices(static_cast<std::size_t>(width) * Height);
+      for (auto &index : indices) {
+        index = static_cast<std::uint8_t>(random() % (numColors + 8));
+      }
+
+      std::vector<std::uint8_t> expected(indices.size() * 4);
+      std::vector<std::uint8_t> actual(indices.size() * 4);
+      scalar.expand(indices.data(), expected.data(), indices.size());
+      vector.expand(indices.data(), actual.data(), indices.size());
+      same = same && expected == actual;
+      for (auto scale = 1; scale <= MaxScale; ++scale) {
+        same = same && expand(scalar, indices, width, scale) == expand(vector, indices, width, scale);
+      }
+    }
+  }
+  check(same, what.c_str());
+}
+}// namespace
+
+int main() {
+  for (auto kernel : {PaletteExpander::Kernel::Ssse3, PaletteExpander::Kernel::Avx2, PaletteExpander::Kernel::Neon}) {
+    if (PaletteExpander::isSupported(kernel)) {
+      testKernel(kernel);
+    }
+  }
+  return TestCheck::getResult();
+}
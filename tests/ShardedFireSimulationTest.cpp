@@ -0,0 +1,95 @@
+#include "ShardedFireSimulation.h"
+#include "TestCheck.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+constexpr int Width = 64;
+constexpr int Height = 100;
+constexpr int ShardCount = 4;
+constexpr int WarmupTicks = 200;
+constexpr int Ticks = 5000;
+// intensities a column may differ by on average, the shards read the spreads of their neighbors a tick late
+constexpr double MaxColumnDifference = 0.5;
+
+using TestCheck::check;
+
+std::vector<double> getColumnMeans(const std::vector<double> &sums) {
+  std::vector<double> means(sums.size());
+  for (std::size_t x = 0; x < sums.size(); ++x) {
+    means[x] = sums[x] / (static_cast<double>(Ticks - WarmupTicks) * Height);
+  }
+  return means;
+}
+
+void addColumns(const std::uint8_t *image, std::vector<double> &sums) {
+  for (auto y = 0; y < Height; ++y) {
+    for (auto x = 0; x < Width; ++x) {
+      sums[static_cast<std::size_t>(x)] += image[static_cast<std::size_t>(y) * Width + x];
+    }
+  }
+}
+
+void testColumnMeans() {
+  FireSimulation single(Width, Height);
+  ShardedFireSimulation sharded(single.getImage(), Width, Height, ShardCount);
+  check(sharded.getShardCount() == ShardCount, "one process per shard");
+
+  std::vector<double> singleSums(Width);
+  std::vector<double> shardedSums(Width);
+  auto inRange = true;
+  for (auto tick = 0; tick < Ticks; ++tick) {
+    single.update();
+    sharded.update();
+    for (auto i = 0; i < Width * Height; ++i) {
+      inRange = inRange && sharded.getImage()[i] <= FireSimulation::MaxIntensity;
+    }
+    if (tick >= WarmupTicks) {
+      addColumns(single.getImage(), singleSums);
+      addColumns(sharded.getImage(), shardedSums);
+    }
+  }
+  check(inRange, "intensities of the sharded fire in range");
+
+  // the edges of the shards and of the image would show as columns darker than the single process ones
+  const auto singleMeans = getColumnMeans(singleSums);
+  const auto shardedMeans = getColumnMeans(shardedSums);
+  auto maxDifference = 0.0;
+  for (auto x = 0; x < Width; ++x) {
+    maxDifference = std::max(maxDifference, std::abs(shardedMeans[static_cast<std::size_t>(x)]
+                                                     - singleMeans[static_cast<std::size_t>(x)]));
+  }
+  if (maxDifference >= MaxColumnDifference) {
+    TestCheck::fail("column means of the sharded fire close to the single process ones, largest difference "
+                    + std::to_string(maxDifference));
+  }
+}
+
+void testReset() {
+  FireSimulation single(Width, Height);
+  ShardedFireSimulation sharded(single.getImage(), Width, Height, ShardCount);
+  for (auto tick = 0; tick < 50; ++tick) {
+    sharded.update();
+  }
+  sharded.reset();
+  check(std::memcmp(sharded.getImage(), single.getImage(), static_cast<std::size_t>(Width) * Height) == 0,
+        "reset clears the image and lights the bottom row");
+  sharded.update();
+  const auto row = sharded.getImage() + static_cast<std::size_t>(Height - 2) * Width;
+  check(std::any_of(row, row + Width, [](std::uint8_t pixel) { return pixel != 0; }),
+        "the fire starts again after a reset");
+}
+}// namespace
+
+int main() {
+  try {
+    testColumnMeans();
+    testReset();
+  } catch (const std::exception &e) {
+    TestCheck::fail(e.what());
+  }
+  return TestCheck::getResult();
+}
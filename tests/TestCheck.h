@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+/// Checks of the tests: a failed check is reported and the test goes on, main returns getResult().
+namespace TestCheck {
+inline int failures = 0;
+
+inline void fail(const std::string &what) {
+  std::cerr << "FAILED: " << what << '\n';
+  failures++;
+}
+
+inline void check(bool condition, const char *what) {
+  if (!condition) {
+    fail(what);
+  }
+}
+
+inline int getResult() {
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+}// namespace TestCheck